@@ -0,0 +1,280 @@
+// End-to-end frame time over the bundled scenes. For every scene under
+// <root>/{required,optional,extra_credit}, resolution and tessellation level,
+// loads the scene (a full parse that bypasses SceneCache, then tessellation
+// and upload), renders warm-up frames, then times each of the measured
+// frames on the CPU (SceneRenderer::render() submission) and the GPU (the
+// profiler's "frame" scope). Every frame ends in glFinish(), so frames never
+// overlap and no GPU sample is dropped. Prints a table and writes JSON:
+//
+//   frametime_bench --root scenefiles/realtime --output frametime.json
+//
+// Like batch_render, it needs no display (QT_QPA_PLATFORM defaults to offscreen).
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "settings.h"
+#include "utils/offscreenrenderer.h"
+
+namespace {
+
+struct Percentiles {
+    double p50, p95, p99;
+};
+
+// Nearest-rank percentiles
+Percentiles percentiles(std::vector<double> samples) {
+    if (samples.empty()) return {0.0, 0.0, 0.0};
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&](double p) {
+        size_t i = size_t(std::ceil(p * samples.size()));
+        return samples[std::clamp<size_t>(i, 1, samples.size()) - 1];
+    };
+    return {rank(0.50), rank(0.95), rank(0.99)};
+}
+
+struct Result {
+    std::string scene;
+    int width, height;
+    int param1, param2;
+    double loadMs;      // uncached parse plus tessellation and upload
+    double parseMs;     // the uncached parse alone
+    double cacheHitMs;  // SceneParser::parse with a warm SceneCache
+    Percentiles cpu, gpu;
+    int drawCalls;
+    int64_t triangles;
+    int instances, culled, occluded;
+    GLState::Stats gl;
+    size_t targetBytes, targetBytesInUse, transientPeakBytes;
+    std::vector<std::pair<std::string, double>> passes; // mean GPU ms per scope
+};
+
+void writeJson(std::ostream& out, const std::string& pipeline, bool bloom, bool occlusion, int frames,
+               const std::vector<Result>& results) {
+    auto p = [&](const Percentiles& v) {
+        out << "{\"p50\":" << v.p50 << ",\"p95\":" << v.p95 << ",\"p99\":" << v.p99 << "}";
+    };
+    out << "{\"pipeline\":\"" << pipeline << "\",\"bloom\":" << (bloom ? "true" : "false")
+        << ",\"occlusion_culling\":" << (occlusion ? "true" : "false")
+        << ",\"frames\":" << frames << ",\"results\":[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << "  {\"scene\":\"" << r.scene << "\",\"width\":" << r.width << ",\"height\":" << r.height
+            << ",\"param1\":" << r.param1 << ",\"param2\":" << r.param2 << ",\"load_ms\":" << r.loadMs
+            << ",\"parse_ms\":" << r.parseMs << ",\"cache_hit_ms\":" << r.cacheHitMs
+            << ",\"cpu_ms\":";
+        p(r.cpu);
+        out << ",\"gpu_ms\":";
+        p(r.gpu);
+        out << ",\"draw_calls\":" << r.drawCalls << ",\"triangles\":" << r.triangles
+            << ",\"instances\":" << r.instances << ",\"culled\":" << r.culled << ",\"occluded\":" << r.occluded
+            << ",\"gl\":{\"draw_calls\":" << r.gl.drawCalls
+            << ",\"state_changes\":" << r.gl.stateChanges << ",\"redundant\":" << r.gl.redundant
+            << ",\"uniform_uploads\":" << r.gl.uniformUploads << ",\"buffer_uploads\":" << r.gl.bufferUploads
+            << ",\"buffer_bytes\":" << r.gl.bufferBytes << "},\"render_targets\":{\"allocated_bytes\":"
+            << r.targetBytes << ",\"in_use_bytes\":" << r.targetBytesInUse << ",\"transient_peak_bytes\":"
+            << r.transientPeakBytes << "},\"passes\":{";
+        for (size_t j = 0; j < r.passes.size(); j++) {
+            out << (j ? "," : "") << "\"" << r.passes[j].first << "\":" << r.passes[j].second;
+        }
+        out << "}}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]}\n";
+}
+
+// "1280x720,1920x1080" -> {{1280,720},{1920,1080}}
+std::vector<std::pair<int, int>> parsePairs(const QString& list) {
+    std::vector<std::pair<int, int>> pairs;
+    for (const QString& item : list.split(',', Qt::SkipEmptyParts)) {
+        QStringList parts = item.split('x');
+        if (parts.size() != 2) continue;
+        pairs.push_back({std::max(parts[0].toInt(), 1), std::max(parts[1].toInt(), 1)});
+    }
+    return pairs;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Frame time over the bundled scene files.");
+    parser.addHelpOption();
+    QCommandLineOption rootOpt("root", "Directory holding required/, optional/ and extra_credit/.",
+                               "dir", "scenefiles/realtime");
+    QCommandLineOption outputOpt({"o", "output"}, "JSON results file.", "file", "frametime.json");
+    QCommandLineOption resOpt("resolutions", "Comma-separated WxH list.", "list", "1280x720,1920x1080");
+    QCommandLineOption tessOpt("tessellation", "Comma-separated param1xparam2 list.", "list", "5x5,25x25");
+    QCommandLineOption warmupOpt("warmup", "Untimed frames per run.", "n", "10");
+    QCommandLineOption framesOpt("frames", "Timed frames per run.", "n", "100");
+    QCommandLineOption pipelineOpt("pipeline", "deferred, tiled or forward.", "name", "deferred");
+    QCommandLineOption bloomOpt("bloom", "Enable bloom.");
+    QCommandLineOption occlusionOpt("occlusion-culling", "Cull shapes hidden in an earlier frame's depth.");
+    parser.addOptions({rootOpt, outputOpt, resOpt, tessOpt, warmupOpt, framesOpt, pipelineOpt, bloomOpt,
+                       occlusionOpt});
+    parser.process(app);
+
+    std::vector<std::pair<int, int>> resolutions = parsePairs(parser.value(resOpt));
+    std::vector<std::pair<int, int>> levels = parsePairs(parser.value(tessOpt));
+    int warmup = std::max(parser.value(warmupOpt).toInt(), 0);
+    // Every timed frame has to still be in the profiler's history
+    int frames = std::clamp(parser.value(framesOpt).toInt(), 1, GpuProfiler::HISTORY);
+
+    std::string pipeline = parser.value(pipelineOpt).toStdString();
+    if (pipeline == "deferred") settings.lightingPipeline = LightingPipeline::Deferred;
+    else if (pipeline == "tiled") settings.lightingPipeline = LightingPipeline::TiledDeferred;
+    else if (pipeline == "forward") settings.lightingPipeline = LightingPipeline::ForwardPlus;
+    else {
+        std::cerr << "Unknown pipeline \"" << pipeline << "\"" << std::endl;
+        return 1;
+    }
+    settings.bloom = parser.isSet(bloomOpt);
+    settings.occlusionCulling = parser.isSet(occlusionOpt);
+
+    std::vector<std::string> scenes;
+    QDir root(parser.value(rootOpt));
+    for (const char* group : {"required", "optional", "extra_credit"}) {
+        QDirIterator it(root.filePath(group), {"*.json"}, QDir::Files, QDirIterator::Subdirectories);
+        QStringList found;
+        while (it.hasNext()) found << it.next();
+        found.sort();
+        for (const QString& s : found) scenes.push_back(s.toStdString());
+    }
+    if (scenes.empty() || resolutions.empty() || levels.empty()) {
+        std::cerr << "Nothing to run; check --root, --resolutions and --tessellation" << std::endl;
+        return 1;
+    }
+
+    QSurfaceFormat fmt;
+    fmt.setVersion(4, 1);
+    fmt.setProfile(QSurfaceFormat::CoreProfile);
+    QOffscreenSurface surface;
+    surface.setFormat(fmt);
+    surface.create();
+    QOpenGLContext context;
+    context.setFormat(fmt);
+    if (!context.create() || !context.makeCurrent(&surface)) {
+        std::cerr << "Could not create a GL 4.1 core context" << std::endl;
+        return 1;
+    }
+    std::string error;
+    if (!OffscreenRenderer::initGL(error)) {
+        std::cerr << "glewInit failed: " << error << std::endl;
+        return 1;
+    }
+
+    std::vector<Result> results;
+    std::printf("%-48s %10s %7s %8s %17s %17s %6s %10s %7s %8s %11s\n", "scene", "size", "tess", "load",
+                "cpu p50/p95/p99", "gpu p50/p95/p99", "draws", "triangles", "culled", "occluded", "binds/skip");
+    for (auto [width, height] : resolutions) {
+        // One renderer and target per resolution; scenes only swap their batches
+        OffscreenRenderer offscreen;
+        offscreen.init(width, height);
+        SceneRenderer& renderer = offscreen.renderer();
+
+        for (auto [param1, param2] : levels) {
+            for (const std::string& path : scenes) {
+                Result r{QDir().relativeFilePath(QString::fromStdString(path)).toStdString(),
+                         width, height, param1, param2};
+
+                // Parse, tessellate and upload, as the app does on open. The
+                // parse skips SceneCache so every row times the same work.
+                QElapsedTimer timer;
+                timer.start();
+                RenderData scene;
+                if (!SceneParser::parseUncached(path, scene)) {
+                    std::cerr << "Failed to parse " << path << std::endl;
+                    continue;
+                }
+                r.parseMs = timer.nsecsElapsed() * 1e-6;
+                offscreen.setScene(scene, param1, param2);
+                glFinish();
+                r.loadMs = timer.nsecsElapsed() * 1e-6;
+
+                // The cache-hit path, timed on its own once the first call has filled the cache
+                RenderData cached;
+                SceneParser::parse(path, cached);
+                timer.restart();
+                SceneParser::parse(path, cached);
+                r.cacheHitMs = timer.nsecsElapsed() * 1e-6;
+
+                std::vector<double> cpu;
+                for (int i = 0; i < warmup + frames; i++) {
+                    timer.restart();
+                    offscreen.render();
+                    double ms = timer.nsecsElapsed() * 1e-6;
+                    glFinish();
+                    if (i >= warmup) cpu.push_back(ms);
+                }
+                r.drawCalls = renderer.stats().drawCalls;
+                r.triangles = renderer.stats().triangles;
+                r.instances = renderer.stats().instances;
+                r.culled = renderer.stats().culled;
+                r.occluded = renderer.stats().occluded;
+                r.gl = renderer.glStats();
+                r.targetBytes = renderer.renderTargets().bytesAllocated();
+                r.targetBytesInUse = renderer.renderTargets().bytesInUse();
+                r.transientPeakBytes = renderer.graph().peakBytes();
+
+                GpuProfiler& profiler = renderer.profiler();
+                profiler.flush();
+                const std::deque<GpuProfiler::Frame>& history = profiler.history();
+                const std::vector<std::string>& names = profiler.names();
+                int frameId = int(std::find(names.begin(), names.end(), "frame") - names.begin());
+                size_t first = history.size() - std::min<size_t>(history.size(), frames);
+
+                std::vector<double> gpu;
+                std::vector<double> passSums(names.size(), 0.0);
+                for (size_t i = first; i < history.size(); i++) {
+                    const std::vector<float>& ms = history[i].ms;
+                    if (frameId < int(ms.size())) gpu.push_back(ms[frameId]);
+                    for (size_t id = 0; id < ms.size(); id++) passSums[id] += ms[id];
+                }
+                for (size_t id = 0; id < names.size(); id++) {
+                    if (passSums[id] > 0.0) r.passes.push_back({names[id], passSums[id] / (history.size() - first)});
+                }
+
+                r.cpu = percentiles(cpu);
+                r.gpu = percentiles(gpu);
+                results.push_back(r);
+
+                std::printf("%-48s %4dx%-5d %3dx%-3d %6.1fms %5.2f/%5.2f/%5.2f %5.2f/%5.2f/%5.2f %6d %10lld %7d %8d %5d/%-5d\n",
+                            r.scene.c_str(), width, height, param1, param2, r.loadMs,
+                            r.cpu.p50, r.cpu.p95, r.cpu.p99, r.gpu.p50, r.gpu.p95, r.gpu.p99,
+                            r.drawCalls, (long long)r.triangles, r.culled, r.occluded,
+                            r.gl.stateChanges, r.gl.redundant);
+            }
+        }
+
+        offscreen.destroy();
+    }
+
+    std::string outputPath = parser.value(outputOpt).toStdString();
+    std::ofstream out(outputPath);
+    if (!out) {
+        std::cerr << "Could not write " << outputPath << std::endl;
+        return 1;
+    }
+    writeJson(out, pipeline, settings.bloom, settings.occlusionCulling, frames, results);
+    std::cout << "Wrote " << results.size() << " results to " << outputPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,188 @@
+// Microbenchmarks for the CPU hot paths: primitive tessellation across
+// parameter sweeps, scene file reading and parsing, and camera matrices.
+// Each case is calibrated to run about TARGET_MS per repetition and repeated
+// REPETITIONS times; the table and the JSON report give the median, mean,
+// standard deviation and minimum time per iteration, plus heap allocations per
+// iteration counted by the global operator new below.
+//
+//   micro_bench [scenefiles root, default scenefiles] [output.json]
+//
+// SceneParser::parse goes through SceneCache, so after the first iteration it
+// measures the cache-hit path; SceneParser::parseUncached and
+// ScenefileReader::readJSON are always the full JSON parse.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "utils/camera.h"
+#include "utils/cone.h"
+#include "utils/cube.h"
+#include "utils/cylinder.h"
+#include "utils/scenefilereader.h"
+#include "utils/sceneparser.h"
+#include "utils/sphere.h"
+
+static std::atomic<uint64_t> g_allocations{0};
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+constexpr int REPETITIONS = 15;
+constexpr double TARGET_MS = 20.0;
+
+struct Result {
+    std::string name;
+    long iterations;      // per repetition
+    double medianUs, meanUs, stddevUs, minUs;
+    double allocations;   // per iteration
+};
+
+// Keeps the optimiser from discarding a benchmark's output
+const void* volatile g_sink;
+template <typename T>
+void keep(const T& value) {
+    g_sink = &value;
+}
+
+Result run(const std::string& name, const std::function<void()>& body) {
+    using Clock = std::chrono::steady_clock;
+    auto msFor = [&](long n) {
+        auto start = Clock::now();
+        for (long i = 0; i < n; i++) body();
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    // Doubling until one repetition is long enough to time reliably
+    long iterations = 1;
+    while (msFor(iterations) < TARGET_MS && iterations < (1L << 30)) iterations *= 2;
+
+    std::vector<double> us;
+    uint64_t allocations = 0;
+    for (int r = 0; r < REPETITIONS; r++) {
+        uint64_t before = g_allocations.load(std::memory_order_relaxed);
+        us.push_back(msFor(iterations) * 1000.0 / iterations);
+        allocations += g_allocations.load(std::memory_order_relaxed) - before;
+    }
+
+    Result res{name, iterations};
+    std::vector<double> sorted = us;
+    std::sort(sorted.begin(), sorted.end());
+    res.medianUs = sorted[sorted.size() / 2];
+    res.minUs = sorted.front();
+    double sum = 0.0;
+    for (double v : us) sum += v;
+    res.meanUs = sum / us.size();
+    double var = 0.0;
+    for (double v : us) var += (v - res.meanUs) * (v - res.meanUs);
+    res.stddevUs = std::sqrt(var / (us.size() - 1));
+    res.allocations = double(allocations) / (double(iterations) * REPETITIONS);
+
+    std::printf("%-44s %10ld %12.3f %12.3f %10.3f %12.3f %10.1f\n", name.c_str(), iterations,
+                res.medianUs, res.meanUs, res.stddevUs, res.minUs, res.allocations);
+    return res;
+}
+
+void writeJson(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    out << "{\"repetitions\":" << REPETITIONS << ",\"results\":[\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << "  {\"name\":\"" << r.name << "\",\"iterations\":" << r.iterations
+            << ",\"median_us\":" << r.medianUs << ",\"mean_us\":" << r.meanUs
+            << ",\"stddev_us\":" << r.stddevUs << ",\"min_us\":" << r.minUs
+            << ",\"allocations\":" << r.allocations << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "]}\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    std::string root = argc > 1 ? argv[1] : "scenefiles";
+    std::string output = argc > 2 ? argv[2] : "micro_bench.json";
+    std::vector<Result> results;
+
+    std::printf("%-44s %10s %12s %12s %10s %12s %10s\n", "benchmark", "iters", "median us",
+                "mean us", "stddev", "min us", "allocs/it");
+
+    for (int p : {1, 5, 10, 25, 50}) {
+        std::string params = "(" + std::to_string(p) + ", " + std::to_string(p) + ")";
+        results.push_back(run("Cube::updateParams(" + std::to_string(p) + ")", [p] {
+            Cube c;
+            c.updateParams(p);
+            keep(c.getIndexData());
+        }));
+        results.push_back(run("Sphere::updateParams" + params, [p] {
+            Sphere s;
+            s.updateParams(p, p);
+            keep(s.getIndexData());
+        }));
+        results.push_back(run("Cylinder::updateParams" + params, [p] {
+            Cylinder c;
+            c.updateParams(p, p);
+            keep(c.getIndexData());
+        }));
+        results.push_back(run("Cone::updateParams" + params, [p] {
+            Cone c;
+            c.updateParams(p, p);
+            keep(c.getIndexData());
+        }));
+    }
+
+    for (const char* scene : {"realtime/required/movement/chess.json", "realtime/optional/recursive_sphere_10.json"}) {
+        std::string path = root + "/" + scene;
+        std::string name = path.substr(path.find_last_of('/') + 1);
+
+        RenderData probe;
+        if (!SceneParser::parse(path, probe)) {
+            std::fprintf(stderr, "Skipping %s: could not parse\n", path.c_str());
+            continue;
+        }
+        results.push_back(run("ScenefileReader::readJSON " + name, [&] {
+            ScenefileReader reader(path);
+            keep(reader.readJSON());
+        }));
+        results.push_back(run("SceneParser::parseUncached " + name, [&] {
+            RenderData data;
+            SceneParser::parseUncached(path, data);
+            keep(data.shapes);
+        }));
+        results.push_back(run("SceneParser::parse " + name, [&] {
+            RenderData data;
+            SceneParser::parse(path, data);
+            keep(data.shapes);
+        }));
+    }
+
+    Camera camera;
+    float t = 0.f;
+    results.push_back(run("Camera::setViewMatrix", [&] {
+        t += 0.001f;
+        camera.setViewMatrix(glm::vec3(std::sin(t), 1.f, 5.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+        keep(camera.getViewMatrix());
+    }));
+    results.push_back(run("Camera::setProjectionMatrix", [&] {
+        t += 0.001f;
+        camera.setProjectionMatrix(4.f / 3.f, 0.1f, 100.f + t, 0.785f);
+        keep(camera.getProjMatrix());
+    }));
+
+    writeJson(output, results);
+    std::printf("Wrote %zu results to %s\n", results.size(), output.c_str());
+    return 0;
+}
@@ -0,0 +1,69 @@
+// CPU cost of TileLightGrid versus light count. For each count, scatters point
+// lights through the view volume of a 1280x960 frame and reports the CPU time
+// of build() and the modeled number of light evaluations per pixel: every
+// light in the single-pass shader, its tile's list in the tiled shader. These
+// are counts, not GPU timings; for the lighting passes' GPU time run
+// frametime_bench with --pipeline deferred and --pipeline tiled.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "utils/tilelightgrid.h"
+
+int main() {
+    const int width = 1280, height = 960;
+    const int iterations = 50;
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.f, 2.f, 10.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+    glm::mat4 proj = glm::perspective(glm::radians(45.f), float(width) / height, 0.1f, 100.f);
+
+    TileLightGrid grid;
+    grid.resize(width, height);
+
+    // Geometry between 4 and 16 units away, varying per tile as in a real frame
+    std::mt19937 rng(1230);
+    std::uniform_real_distribution<float> near(4.f, 10.f), span(0.5f, 6.f);
+    std::vector<glm::vec2> depthBounds(grid.tilesX * grid.tilesY);
+    for (glm::vec2 &b : depthBounds) {
+        b.x = near(rng);
+        b.y = b.x + span(rng);
+    }
+
+    std::printf("%8s %12s %16s %16s\n", "lights", "build (us)", "evals/px single", "evals/px tiled");
+    for (int count : {8, 32, 128, 512, 2048, 8192}) {
+        std::uniform_real_distribution<float> xy(-12.f, 12.f), z(-10.f, 4.f);
+        std::vector<SceneLightData> lights(count);
+        for (SceneLightData &L : lights) {
+            L.type = LightType::LIGHT_POINT;
+            // Falls below LIGHT_CUTOFF about 3.5 units out
+            L.color = glm::vec4(0.2f, 0.2f, 0.2f, 1.f);
+            L.function = glm::vec3(1.f, 0.f, 4.f);
+            L.pos = glm::vec4(xy(rng), xy(rng) * 0.5f, z(rng), 1.f);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            grid.build(lights, view, proj, depthBounds);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        double us = std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+
+        // Edge tiles are partly off screen, so weight each tile by its pixel count
+        double evaluations = 0.0;
+        for (int ty = 0; ty < grid.tilesY; ty++) {
+            for (int tx = 0; tx < grid.tilesX; tx++) {
+                const TileLightGrid::Tile &t = grid.tiles()[ty * grid.tilesX + tx];
+                int w = std::min(TileLightGrid::TILE_SIZE, width - tx * TileLightGrid::TILE_SIZE);
+                int h = std::min(TileLightGrid::TILE_SIZE, height - ty * TileLightGrid::TILE_SIZE);
+                evaluations += double(t.numPoint + t.numSpot) * w * h;
+            }
+        }
+
+        std::printf("%8d %12.1f %16d %16.2f\n", count, us, count, evaluations / (width * height));
+    }
+    return 0;
+}
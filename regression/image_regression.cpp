@@ -0,0 +1,313 @@
+// Image regression against the reference renders. Each manifest row names a
+// scene, its reference PNG and the tessellation and clip planes the reference
+// was made with. Worker threads (one GL context each, as in batch_render)
+// render every scene headlessly at its reference's size; the comparisons run
+// on the Qt thread pool while rendering carries on. For every case the render
+// and a difference heatmap are written to the output directory, with a JSON
+// summary of RMSE and SSIM. Exits non-zero if any case fails a threshold.
+//
+//   image_regression --root scenefiles/realtime --manifest regression/required.txt
+//
+// The references have no bloom, so bloom stays off unless --bloom is given. They
+// are full Phong (ambient, diffuse, specular with ka/kd/ks), which only the
+// forward pipeline shades, so forward is the default. The deferred pipelines
+// shade diffuse and emissive only; they are checked against another pipeline
+// instead of the references:
+//
+//   image_regression --pipeline tiled --against forward --diffuse-only
+//
+// renders every case with forward first, then with tiled, and compares the two.
+// --diffuse-only zeroes the scenes' ka and ks for both.
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QGuiApplication>
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "imagediff.h"
+#include "settings.h"
+#include "utils/offscreenrenderer.h"
+
+namespace {
+
+struct Case {
+    QString scene;     // relative to the root
+    QString reference; // relative to the root
+    int param1, param2;
+    float nearPlane, farPlane;
+    QString name;      // reference file name without extension
+};
+
+struct Result {
+    bool rendered = false;
+    QString error;
+    ImageDiff diff{0.0, 0.0};
+};
+
+struct Thresholds {
+    double maxRmse;
+    double minSsim;
+};
+
+struct Pass {
+    bool diffuseOnly; // zero the scene's ka and ks
+    // Keep every render in images instead of comparing it; a later pass then
+    // compares against images[i] in place of the case's reference file
+    bool capture;
+};
+
+std::mutex g_logMutex;
+
+void report(const QString& line) {
+    std::lock_guard<std::mutex> lock(g_logMutex);
+    std::cout << line.toStdString() << std::endl;
+}
+
+bool parsePipeline(const QString& name, LightingPipeline& pipeline) {
+    if (name == "deferred") pipeline = LightingPipeline::Deferred;
+    else if (name == "tiled") pipeline = LightingPipeline::TiledDeferred;
+    else if (name == "forward") pipeline = LightingPipeline::ForwardPlus;
+    else {
+        std::cerr << "Unknown pipeline \"" << name.toStdString() << "\"" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Whitespace-separated rows of scene, reference, param1, param2, near, far;
+// blank lines and lines starting with # are skipped
+bool readManifest(const QString& path, std::vector<Case>& cases) {
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#')) continue;
+        QStringList f = line.split(' ', Qt::SkipEmptyParts);
+        if (f.size() != 6) {
+            std::cerr << "Skipping malformed manifest line: " << line.toStdString() << std::endl;
+            continue;
+        }
+        cases.push_back({f[0], f[1], std::max(f[2].toInt(), 1), std::max(f[3].toInt(), 1),
+                         f[4].toFloat(), f[5].toFloat(), QFileInfo(f[1]).completeBaseName()});
+    }
+    return true;
+}
+
+void compare(const Case& c, QImage render, QImage reference, const QDir& outputDir, Result& result) {
+    QImage heatmap(render.size(), QImage::Format_RGBA8888);
+    result.diff = compareImages(render.constBits(), reference.constBits(), render.width(), render.height(),
+                                int(render.bytesPerLine()), heatmap.bits());
+    result.rendered = true;
+    render.save(outputDir.filePath(c.name + ".png"));
+    heatmap.save(outputDir.filePath(c.name + "_diff.png"));
+}
+
+// Renders cases on the calling thread with its own context until the counter
+// runs out, queueing each comparison on the global thread pool
+void renderCases(QOpenGLContext* context, QOffscreenSurface* surface, const QDir& root, const QDir& outputDir,
+                 const std::vector<Case>& cases, std::vector<Result>& results, std::vector<QImage>& images,
+                 const Pass& pass, std::atomic<size_t>& next) {
+    if (!context->makeCurrent(surface)) {
+        report("Could not make the GL context current");
+        return;
+    }
+    std::string error;
+    if (!OffscreenRenderer::initGL(error)) {
+        report(QString("glewInit failed: ") + QString::fromStdString(error));
+        return;
+    }
+
+    OffscreenRenderer renderer;
+    renderer.init(1, 1);
+    for (size_t i = next++; i < cases.size(); i = next++) {
+        const Case& c = cases[i];
+        Result& result = results[i];
+        if (!result.error.isEmpty()) continue; // failed in an earlier pass
+
+        // Renders are made at the reference's size even when compared with another pipeline
+        QImage reference(root.filePath(c.reference));
+        if (reference.isNull()) {
+            result.error = "could not read " + c.reference;
+            continue;
+        }
+        reference = images[i].isNull() ? reference.convertToFormat(QImage::Format_RGBA8888) : images[i];
+
+        RenderData scene;
+        if (!SceneParser::parse(root.filePath(c.scene).toStdString(), scene)) {
+            result.error = "could not parse " + c.scene;
+            continue;
+        }
+        if (pass.diffuseOnly) scene.globalData.ka = scene.globalData.ks = 0.f;
+        renderer.resize(reference.width(), reference.height());
+        renderer.setScene(scene, c.param1, c.param2, c.nearPlane, c.farPlane);
+        renderer.render();
+        QImage render = renderer.readback();
+        if (pass.capture) {
+            images[i] = render.convertToFormat(QImage::Format_RGBA8888);
+            continue;
+        }
+
+        QThreadPool::globalInstance()->start([&c, &result, &outputDir, render, reference] {
+            compare(c, render, reference, outputDir, result);
+        });
+    }
+
+    renderer.destroy();
+    context->doneCurrent();
+}
+
+void writeJson(std::ostream& out, const std::vector<Case>& cases, const std::vector<Result>& results,
+               const Thresholds& thresholds) {
+    out << "{\"max_rmse\":" << thresholds.maxRmse << ",\"min_ssim\":" << thresholds.minSsim << ",\"cases\":[\n";
+    for (size_t i = 0; i < cases.size(); i++) {
+        const Result& r = results[i];
+        bool pass = r.rendered && r.diff.rmse <= thresholds.maxRmse && r.diff.ssim >= thresholds.minSsim;
+        out << "  {\"name\":\"" << cases[i].name.toStdString() << "\",\"scene\":\"" << cases[i].scene.toStdString()
+            << "\",\"param1\":" << cases[i].param1 << ",\"param2\":" << cases[i].param2;
+        if (r.rendered) out << ",\"rmse\":" << r.diff.rmse << ",\"ssim\":" << r.diff.ssim;
+        else out << ",\"error\":\"" << r.error.toStdString() << "\"";
+        out << ",\"pass\":" << (pass ? "true" : "false") << "}" << (i + 1 < cases.size() ? "," : "") << "\n";
+    }
+    out << "]}\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("image_regression");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares headless renders against the reference images.");
+    parser.addHelpOption();
+    QCommandLineOption rootOpt("root", "Directory the manifest paths are relative to.", "dir",
+                               "scenefiles/realtime");
+    QCommandLineOption manifestOpt("manifest", "Cases to run.", "file", "regression/required.txt");
+    QCommandLineOption outputOpt({"o", "output"}, "Directory for renders, heatmaps and results.json.", "dir",
+                                 "regression_out");
+    QCommandLineOption rmseOpt("max-rmse", "Largest RGB RMSE that passes, in [0, 1].", "x", "0.02");
+    QCommandLineOption ssimOpt("min-ssim", "Smallest SSIM that passes.", "x", "0.95");
+    QCommandLineOption pipelineOpt("pipeline", "forward, deferred or tiled (default: forward).", "name", "forward");
+    QCommandLineOption againstOpt("against", "Compare with renders from this pipeline instead of the references.",
+                                  "name");
+    QCommandLineOption diffuseOnlyOpt("diffuse-only", "Zero every scene's ka and ks.");
+    QCommandLineOption bloomOpt("bloom", "Enable bloom.");
+    QCommandLineOption jobsOpt({"j", "jobs"}, "Scenes rendered in parallel, one GL context each.", "n",
+                               QString::number(QThread::idealThreadCount()));
+    parser.addOptions({rootOpt, manifestOpt, outputOpt, rmseOpt, ssimOpt, pipelineOpt, againstOpt, diffuseOnlyOpt,
+                       bloomOpt, jobsOpt});
+    parser.process(app);
+
+    Thresholds thresholds{parser.value(rmseOpt).toDouble(), parser.value(ssimOpt).toDouble()};
+
+    // Read-only while the workers run
+    settings.bloom = parser.isSet(bloomOpt);
+    LightingPipeline pipeline, against = LightingPipeline::ForwardPlus;
+    if (!parsePipeline(parser.value(pipelineOpt), pipeline)) return 1;
+    bool compareAgainst = parser.isSet(againstOpt);
+    if (compareAgainst && !parsePipeline(parser.value(againstOpt), against)) return 1;
+    bool diffuseOnly = parser.isSet(diffuseOnlyOpt);
+
+    std::vector<Case> cases;
+    if (!readManifest(parser.value(manifestOpt), cases) || cases.empty()) {
+        std::cerr << "No cases in " << parser.value(manifestOpt).toStdString() << std::endl;
+        return 1;
+    }
+    std::vector<Result> results(cases.size());
+    std::vector<QImage> images(cases.size()); // the --against renders
+    QDir root(parser.value(rootOpt));
+    QDir outputDir(parser.value(outputOpt));
+    QDir().mkpath(outputDir.path());
+
+    QSurfaceFormat fmt;
+    fmt.setVersion(4, 1);
+    fmt.setProfile(QSurfaceFormat::CoreProfile);
+    QSurfaceFormat::setDefaultFormat(fmt);
+
+    // Renders every case with one pipeline; settings only change between passes
+    int jobs = std::clamp(parser.value(jobsOpt).toInt(), 1, int(cases.size()));
+    auto runPass = [&](LightingPipeline passPipeline, const Pass& pass) {
+        settings.lightingPipeline = passPipeline;
+        struct Worker {
+            std::unique_ptr<QOffscreenSurface> surface;
+            std::unique_ptr<QOpenGLContext> context;
+            QThread* thread = nullptr;
+        };
+        std::vector<Worker> workers(jobs);
+        std::atomic<size_t> next{0};
+        for (Worker& w : workers) {
+            w.surface = std::make_unique<QOffscreenSurface>();
+            w.surface->setFormat(fmt);
+            w.surface->create();
+            w.context = std::make_unique<QOpenGLContext>();
+            w.context->setFormat(fmt);
+            if (!w.context->create()) {
+                std::cerr << "Could not create a GL 4.1 core context" << std::endl;
+                return false;
+            }
+        }
+        for (Worker& w : workers) {
+            w.thread = QThread::create([&w, &root, &outputDir, &cases, &results, &images, &pass, &next] {
+                renderCases(w.context.get(), w.surface.get(), root, outputDir, cases, results, images, pass, next);
+            });
+            w.context->moveToThread(w.thread);
+            w.thread->start();
+        }
+        for (Worker& w : workers) {
+            w.thread->wait();
+            delete w.thread;
+        }
+        return true;
+    };
+    if (compareAgainst && !runPass(against, {diffuseOnly, true})) return 1;
+    if (!runPass(pipeline, {diffuseOnly, false})) return 1;
+    QThreadPool::globalInstance()->waitForDone();
+
+    int failed = 0;
+    double worstRmse = 0.0, worstSsim = 1.0; // what the thresholds are calibrated from
+    std::printf("%-32s %10s %10s  %s\n", "case", "rmse", "ssim", "result");
+    for (size_t i = 0; i < cases.size(); i++) {
+        const Result& r = results[i];
+        bool pass = r.rendered && r.diff.rmse <= thresholds.maxRmse && r.diff.ssim >= thresholds.minSsim;
+        if (!pass) failed++;
+        if (r.rendered) {
+            worstRmse = std::max(worstRmse, r.diff.rmse);
+            worstSsim = std::min(worstSsim, r.diff.ssim);
+            std::printf("%-32s %10.5f %10.5f  %s\n", cases[i].name.toStdString().c_str(), r.diff.rmse,
+                        r.diff.ssim, pass ? "pass" : "FAIL");
+        } else {
+            std::printf("%-32s %10s %10s  FAIL (%s)\n", cases[i].name.toStdString().c_str(), "-", "-",
+                        (r.error.isEmpty() ? QString("not rendered") : r.error).toStdString().c_str());
+        }
+    }
+
+    std::string summary = outputDir.filePath("results.json").toStdString();
+    std::ofstream out(summary);
+    if (out) writeJson(out, cases, results, thresholds);
+    std::printf("worst rmse %.5f, worst ssim %.5f\n", worstRmse, worstSsim);
+    std::cout << cases.size() - failed << "/" << cases.size() << " cases passed; renders and heatmaps in "
+              << outputDir.path().toStdString() << ", summary in " << summary << std::endl;
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+#include "imagediff.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGEDIFF_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr int SSIM_WINDOW = 8;
+constexpr int SSIM_STEP = 4;
+
+// Sum of squared RGB differences over one row
+uint64_t rowSquaredError(const uint8_t* a, const uint8_t* b, int width) {
+    uint64_t sum = 0;
+    int x = 0;
+#ifdef IMAGEDIFF_SSE2
+    // Four pixels per step: |a - b| per byte, alpha masked off, widened to 16 bits
+    // and squared-and-summed pairwise into 32-bit lanes. A 32-bit lane holds at
+    // least 16k pixels' worth, so the row is flushed every 4096 pixels.
+    const __m128i rgbMask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i zero = _mm_setzero_si128();
+    while (x + 4 <= width) {
+        __m128i acc = zero;
+        int end = std::min(width & ~3, x + 4096);
+        for (; x < end; x += 4) {
+            __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + 4 * x));
+            __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + 4 * x));
+            __m128i d = _mm_and_si128(_mm_sub_epi8(_mm_max_epu8(va, vb), _mm_min_epu8(va, vb)), rgbMask);
+            __m128i lo = _mm_unpacklo_epi8(d, zero);
+            __m128i hi = _mm_unpackhi_epi8(d, zero);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(lo, lo));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(hi, hi));
+        }
+        alignas(16) uint32_t lanes[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+        sum += uint64_t(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+    for (; x < width; x++) {
+        for (int c = 0; c < 3; c++) {
+            int d = int(a[4 * x + c]) - int(b[4 * x + c]);
+            sum += uint64_t(d * d);
+        }
+    }
+    return sum;
+}
+
+// Rec. 601 luma of one row, in [0, 255]
+void rowLuma(const uint8_t* src, float* dst, int width) {
+    int x = 0;
+#ifdef IMAGEDIFF_SSE2
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    const __m128 wr = _mm_set1_ps(0.299f), wg = _mm_set1_ps(0.587f), wb = _mm_set1_ps(0.114f);
+    for (; x + 4 <= width; x += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * x));
+        __m128 r = _mm_cvtepi32_ps(_mm_and_si128(v, byteMask));
+        __m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 8), byteMask));
+        __m128 b = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(v, 16), byteMask));
+        __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, wr), _mm_mul_ps(g, wg)), _mm_mul_ps(b, wb));
+        _mm_storeu_ps(dst + x, y);
+    }
+#endif
+    for (; x < width; x++) {
+        dst[x] = 0.299f * src[4 * x] + 0.587f * src[4 * x + 1] + 0.114f * src[4 * x + 2];
+    }
+}
+
+// SSIM of the SSIM_WINDOW square at (x0, y0) of two luma planes
+double windowSsim(const float* a, const float* b, int width, int x0, int y0) {
+    float sa, sb, saa, sbb, sab;
+#ifdef IMAGEDIFF_SSE2
+    __m128 va = _mm_setzero_ps(), vb = va, vaa = va, vbb = va, vab = va;
+    for (int y = y0; y < y0 + SSIM_WINDOW; y++) {
+        for (int x = x0; x < x0 + SSIM_WINDOW; x += 4) {
+            __m128 pa = _mm_loadu_ps(a + size_t(y) * width + x);
+            __m128 pb = _mm_loadu_ps(b + size_t(y) * width + x);
+            va = _mm_add_ps(va, pa);
+            vb = _mm_add_ps(vb, pb);
+            vaa = _mm_add_ps(vaa, _mm_mul_ps(pa, pa));
+            vbb = _mm_add_ps(vbb, _mm_mul_ps(pb, pb));
+            vab = _mm_add_ps(vab, _mm_mul_ps(pa, pb));
+        }
+    }
+    auto hsum = [](__m128 v) {
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, v);
+        return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    };
+    sa = hsum(va), sb = hsum(vb), saa = hsum(vaa), sbb = hsum(vbb), sab = hsum(vab);
+#else
+    sa = sb = saa = sbb = sab = 0.f;
+    for (int y = y0; y < y0 + SSIM_WINDOW; y++) {
+        for (int x = x0; x < x0 + SSIM_WINDOW; x++) {
+            float pa = a[size_t(y) * width + x], pb = b[size_t(y) * width + x];
+            sa += pa;
+            sb += pb;
+            saa += pa * pa;
+            sbb += pb * pb;
+            sab += pa * pb;
+        }
+    }
+#endif
+    const double n = SSIM_WINDOW * SSIM_WINDOW;
+    const double c1 = (0.01 * 255) * (0.01 * 255), c2 = (0.03 * 255) * (0.03 * 255);
+    double ma = sa / n, mb = sb / n;
+    double vara = saa / n - ma * ma, varb = sbb / n - mb * mb, cov = sab / n - ma * mb;
+    return ((2 * ma * mb + c1) * (2 * cov + c2)) / ((ma * ma + mb * mb + c1) * (vara + varb + c2));
+}
+
+void writeHeatmap(const uint8_t* a, const uint8_t* b, int width, int height, int stride, uint8_t* out) {
+    for (int y = 0; y < height; y++) {
+        const uint8_t* ra = a + size_t(y) * stride;
+        const uint8_t* rb = b + size_t(y) * stride;
+        uint8_t* ro = out + size_t(y) * stride;
+        for (int x = 0; x < width; x++) {
+            int d = 0;
+            for (int c = 0; c < 3; c++) d = std::max(d, std::abs(int(ra[4 * x + c]) - int(rb[4 * x + c])));
+            // Small differences are stretched so they stay visible
+            float t = std::sqrt(d / 255.f);
+            ro[4 * x + 0] = uint8_t(255 * std::min(1.f, 2.f * t));
+            ro[4 * x + 1] = uint8_t(255 * std::max(0.f, 2.f * t - 1.f));
+            ro[4 * x + 2] = 0;
+            ro[4 * x + 3] = 255;
+        }
+    }
+}
+
+} // namespace
+
+ImageDiff compareImages(const uint8_t* a, const uint8_t* b, int width, int height, int stride,
+                        uint8_t* heatmap) {
+    ImageDiff diff{0.0, 1.0};
+    if (width <= 0 || height <= 0) return diff;
+
+    uint64_t squared = 0;
+    std::vector<float> lumaA(size_t(width) * height), lumaB(size_t(width) * height);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* ra = a + size_t(y) * stride;
+        const uint8_t* rb = b + size_t(y) * stride;
+        squared += rowSquaredError(ra, rb, width);
+        rowLuma(ra, lumaA.data() + size_t(y) * width, width);
+        rowLuma(rb, lumaB.data() + size_t(y) * width, width);
+    }
+    diff.rmse = std::sqrt(double(squared) / (3.0 * width * height)) / 255.0;
+
+    double ssim = 0.0;
+    int windows = 0;
+    for (int y = 0; y + SSIM_WINDOW <= height; y += SSIM_STEP) {
+        for (int x = 0; x + SSIM_WINDOW <= width; x += SSIM_STEP) {
+            ssim += windowSsim(lumaA.data(), lumaB.data(), width, x, y);
+            windows++;
+        }
+    }
+    if (windows > 0) diff.ssim = ssim / windows;
+
+    if (heatmap) writeHeatmap(a, b, width, height, stride, heatmap);
+    return diff;
+}
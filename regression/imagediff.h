@@ -0,0 +1,14 @@
+#pragma once
+#include <cstdint>
+
+// Compares two RGBA8 images of the same size; alpha is ignored
+struct ImageDiff {
+    double rmse; // root mean square error over RGB, in [0, 1]
+    double ssim; // mean structural similarity of luma over 8x8 windows, 1 if identical
+};
+
+// @param stride bytes per row of a, b and heatmap
+// @param heatmap optional RGBA8 output, black where the images agree, through
+//        red to yellow at the largest per-channel difference
+ImageDiff compareImages(const uint8_t* a, const uint8_t* b, int width, int height, int stride,
+                        uint8_t* heatmap = nullptr);
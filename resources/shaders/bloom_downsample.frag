@@ -0,0 +1,18 @@
+#version 330 core
+
+in vec2 vUV;
+out vec4 fragColor;
+
+uniform sampler2D source;
+uniform vec2 texelSize; // of source
+
+// Halves the resolution: bilinear centre tap plus four diagonal taps, each of
+// which already averages a 2x2 footprint, so the filter spans 4x4 source texels
+void main() {
+    vec3 sum = texture(source, vUV).rgb * 4.0;
+    sum += texture(source, vUV + texelSize * vec2(-1.0, -1.0)).rgb;
+    sum += texture(source, vUV + texelSize * vec2( 1.0, -1.0)).rgb;
+    sum += texture(source, vUV + texelSize * vec2(-1.0,  1.0)).rgb;
+    sum += texture(source, vUV + texelSize * vec2( 1.0,  1.0)).rgb;
+    fragColor = vec4(sum / 8.0, 1.0);
+}
@@ -0,0 +1,21 @@
+#version 330 core
+
+in vec2 vUV;
+out vec4 fragColor;
+
+uniform sampler2D source;
+uniform vec2 texelSize; // of source, the smaller level
+
+// 3x3 tent filter; the result is blended additively onto the larger level
+void main() {
+    vec3 sum = texture(source, vUV).rgb * 4.0;
+    sum += texture(source, vUV + texelSize * vec2(-1.0,  0.0)).rgb * 2.0;
+    sum += texture(source, vUV + texelSize * vec2( 1.0,  0.0)).rgb * 2.0;
+    sum += texture(source, vUV + texelSize * vec2( 0.0, -1.0)).rgb * 2.0;
+    sum += texture(source, vUV + texelSize * vec2( 0.0,  1.0)).rgb * 2.0;
+    sum += texture(source, vUV + texelSize * vec2(-1.0, -1.0)).rgb;
+    sum += texture(source, vUV + texelSize * vec2( 1.0, -1.0)).rgb;
+    sum += texture(source, vUV + texelSize * vec2(-1.0,  1.0)).rgb;
+    sum += texture(source, vUV + texelSize * vec2( 1.0,  1.0)).rgb;
+    fragColor = vec4(sum / 16.0, 1.0);
+}
@@ -1,17 +1,20 @@
 #version 330 core
-out vec4 FragColor;
-in vec2 uv;
+
+in vec2 vUV;
+out vec4 fragColor;
 
 uniform sampler2D sceneTex;
-uniform sampler2D bloomTex;
+uniform sampler2D bloomTex; // half resolution, sampled bilinearly
+uniform float bloomStrength;
 
-void main()
-{
-    vec3 scene = texture(sceneTex, uv).rgb;
-    vec3 bloom = texture(bloomTex, uv).rgb;
+// ACES filmic curve fit (Narkowicz 2015)
+vec3 tonemap(vec3 x) {
+    return clamp((x * (2.51 * x + 0.03)) / (x * (2.43 * x + 0.59) + 0.14), 0.0, 1.0);
+}
 
-    // HDR bloom combine
-    vec3 color = scene + bloom;
+void main() {
+    vec3 scene = texture(sceneTex, vUV).rgb;
+    vec3 bloom = texture(bloomTex, vUV).rgb;
 
-    FragColor = vec4(color, 1.0);
+    fragColor = vec4(tonemap(scene + bloom * bloomStrength), 1.0);
 }
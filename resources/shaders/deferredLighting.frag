@@ -1,47 +1,133 @@
 #version 330 core
 
+// Diffuse-only lighting of the G-buffer. Each light type is shaded as in
+// default.frag: directional lights along their direction, spot lights with a
+// smooth penumbra, and distance attenuation clamped to at most 1. The albedo
+// already carries k_d. There is no ambient or specular term, so image_regression
+// checks this against forward renders with ka and ks zeroed (--diffuse-only).
+
 in vec2 vUV;
-out vec4 fragColor;
+layout(location = 0) out vec4 fragColor;
+// Bright-pass for bloom; dropped when rendering straight to the backbuffer
+layout(location = 1) out vec4 brightColor;
+
+uniform float bloomThreshold; // luminance
 
-uniform sampler2D gPosition;
+uniform sampler2D gDepth;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedo;
 uniform sampler2D gEmissive;
+uniform bool hasEmissive; // gEmissive is unbound when false
 
-uniform int numLights;
-uniform vec3 camPos;
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    mat4 invViewProj;
+    vec4 camPos;
+} frame;
 
-struct Light {
-    int type;
-    vec3 pos;
-    vec3 dir;
-    vec3 atten;
-    float angle;
-    float penumbra;
-    vec3 color;
-};
+// LightBuffer: 4 texels per light, sorted directional, point, spot
+//   [0] pos.xyz, angle  [1] dir.xyz, penumbra  [2] color.rgb  [3] atten.xyz
+uniform samplerBuffer lightData;
+uniform int numDirectional;
+uniform int numPoint;
+uniform int numSpot;
+
+// Octahedral normal decoding (see gbuffer.frag)
+vec3 decodeNormal(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+// World position from the depth buffer
+vec3 reconstructPosition(vec2 uv, float depth) {
+    vec4 p = frame.invViewProj * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return p.xyz / p.w;
+}
 
-uniform Light lights[8];
+// Distance attenuation: 1 / (a + b*d + c*d^2), clamped to [0,1]
+float distanceFalloff(vec3 coeffs, float d) {
+    float denom = coeffs.x + d * (coeffs.y + coeffs.z * d);
+    return min(1.0, 1.0 / max(denom, 1e-6));
+}
+
+// Smooth spotlight falloff between inner & outer angle
+float spotFalloff(float angleToAxis, float outerAngle, float penumbra) {
+    float inner = outerAngle - penumbra;
+    if (angleToAxis <= inner) return 1.0;
+    if (angleToAxis >= outerAngle) return 0.0;
+
+    float t = (angleToAxis - inner) / (outerAngle - inner);
+    return 1.0 - t * t * (3.0 - 2.0 * t);
+}
+
+// Part of the colour above the bloom threshold
+vec3 brightPass(vec3 c) {
+    float luminance = dot(c, vec3(0.2126, 0.7152, 0.0722));
+    return c * (max(luminance - bloomThreshold, 0.0) / max(luminance, 1e-4));
+}
 
 void main() {
-    vec3 pos = texture(gPosition, vUV).xyz;
-    vec3 nor = normalize(texture(gNormal, vUV).xyz);
+    float depth = texture(gDepth, vUV).r;
+    if (depth == 1.0) {
+        // Background, matches the geometry pass clear colour
+        fragColor = vec4(0.0, 0.0, 0.0, 1.0);
+        brightColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    vec3 pos = reconstructPosition(vUV, depth);
+    vec3 nor = decodeNormal(texture(gNormal, vUV).rg);
     vec3 albedo = texture(gAlbedo, vUV).rgb;
-    vec3 emissive = texture(gEmissive, vUV).rgb;
 
-    vec3 result = emissive;
+    vec3 result = hasEmissive ? texture(gEmissive, vUV).rgb : vec3(0.0);
 
-    for (int i = 0; i < numLights; i++) {
-        vec3 Ldir = lights[i].pos - pos;
+    int base = 0;
+    for (int i = base; i < base + numDirectional; i++) {
+        vec3 dir   = texelFetch(lightData, i * 4 + 1).xyz;
+        vec3 color = texelFetch(lightData, i * 4 + 2).rgb;
+
+        float diff = max(dot(nor, normalize(-dir)), 0.0);
+        result += albedo * diff * color;
+    }
+
+    base += numDirectional;
+    for (int i = base; i < base + numPoint; i++) {
+        vec3 lpos  = texelFetch(lightData, i * 4 + 0).xyz;
+        vec3 color = texelFetch(lightData, i * 4 + 2).rgb;
+        vec3 atten = texelFetch(lightData, i * 4 + 3).xyz;
+
+        vec3 Ldir = lpos - pos;
         float dist = length(Ldir);
         Ldir /= dist;
 
         float diff = max(dot(nor, Ldir), 0.0);
-        float atten = 1.0 / (lights[i].atten.x + lights[i].atten.y * dist + lights[i].atten.z * dist * dist);
-        vec3 contrib = albedo * diff * lights[i].color * atten;
+        result += albedo * diff * color * distanceFalloff(atten, dist);
+    }
 
-        result += contrib;
+    base += numPoint;
+    for (int i = base; i < base + numSpot; i++) {
+        vec4 t0    = texelFetch(lightData, i * 4 + 0);
+        vec4 t1    = texelFetch(lightData, i * 4 + 1);
+        vec3 color = texelFetch(lightData, i * 4 + 2).rgb;
+        vec3 atten = texelFetch(lightData, i * 4 + 3).xyz;
+
+        vec3 Ldir = t0.xyz - pos;
+        float dist = length(Ldir);
+        Ldir /= dist;
+
+        float angleToAxis = acos(clamp(dot(-Ldir, normalize(t1.xyz)), -1.0, 1.0));
+        float falloff = distanceFalloff(atten, dist) * spotFalloff(angleToAxis, t0.w, t1.w);
+
+        float diff = max(dot(nor, Ldir), 0.0);
+        result += albedo * diff * color * falloff;
     }
 
     fragColor = vec4(result, 1.0);
+    brightColor = vec4(brightPass(result), 1.0);
 }
@@ -0,0 +1,135 @@
+#version 330 core
+
+in vec2 vUV;
+layout(location = 0) out vec4 fragColor;
+// Bright-pass for bloom; dropped when rendering straight to the backbuffer
+layout(location = 1) out vec4 brightColor;
+
+uniform float bloomThreshold; // luminance
+
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gEmissive;
+uniform bool hasEmissive; // gEmissive is unbound when false
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    mat4 invViewProj;
+    vec4 camPos;
+} frame;
+
+// LightBuffer: 4 texels per light, sorted directional, point, spot
+//   [0] pos.xyz, angle  [1] dir.xyz, penumbra  [2] color.rgb  [3] atten.xyz
+uniform samplerBuffer lightData;
+uniform int numDirectional;
+
+// TileLightGrid: per 16x16 tile (offset, numPoint, numSpot, pad) into
+// tileIndices, which holds light indices with points before spots
+uniform isamplerBuffer tiles;
+uniform isamplerBuffer tileIndices;
+uniform int tileSize;
+uniform int tilesX;
+
+// Octahedral normal decoding (see gbuffer.frag)
+vec3 decodeNormal(vec2 e) {
+    e = e * 2.0 - 1.0;
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+// World position from the depth buffer
+vec3 reconstructPosition(vec2 uv, float depth) {
+    vec4 p = frame.invViewProj * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    return p.xyz / p.w;
+}
+
+// Distance attenuation: 1 / (a + b*d + c*d^2), clamped to [0,1]
+float distanceFalloff(vec3 coeffs, float d) {
+    float denom = coeffs.x + d * (coeffs.y + coeffs.z * d);
+    return min(1.0, 1.0 / max(denom, 1e-6));
+}
+
+// Smooth spotlight falloff between inner & outer angle
+float spotFalloff(float angleToAxis, float outerAngle, float penumbra) {
+    float inner = outerAngle - penumbra;
+    if (angleToAxis <= inner) return 1.0;
+    if (angleToAxis >= outerAngle) return 0.0;
+
+    float t = (angleToAxis - inner) / (outerAngle - inner);
+    return 1.0 - t * t * (3.0 - 2.0 * t);
+}
+
+// Part of the colour above the bloom threshold
+vec3 brightPass(vec3 c) {
+    float luminance = dot(c, vec3(0.2126, 0.7152, 0.0722));
+    return c * (max(luminance - bloomThreshold, 0.0) / max(luminance, 1e-4));
+}
+
+void main() {
+    float depth = texture(gDepth, vUV).r;
+    if (depth == 1.0) {
+        // Background, matches the geometry pass clear colour
+        fragColor = vec4(0.0, 0.0, 0.0, 1.0);
+        brightColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    vec3 pos = reconstructPosition(vUV, depth);
+    vec3 nor = decodeNormal(texture(gNormal, vUV).rg);
+    vec3 albedo = texture(gAlbedo, vUV).rgb;
+
+    vec3 result = hasEmissive ? texture(gEmissive, vUV).rgb : vec3(0.0);
+
+    // Directional lights reach every pixel and are not culled
+    for (int i = 0; i < numDirectional; i++) {
+        vec3 dir   = texelFetch(lightData, i * 4 + 1).xyz;
+        vec3 color = texelFetch(lightData, i * 4 + 2).rgb;
+
+        float diff = max(dot(nor, normalize(-dir)), 0.0);
+        result += albedo * diff * color;
+    }
+
+    ivec2 tileCoord = ivec2(gl_FragCoord.xy) / tileSize;
+    ivec4 tile = texelFetch(tiles, tileCoord.y * tilesX + tileCoord.x);
+
+    for (int k = tile.x; k < tile.x + tile.y; k++) {
+        int i = texelFetch(tileIndices, k).x;
+        vec3 lpos  = texelFetch(lightData, i * 4 + 0).xyz;
+        vec3 color = texelFetch(lightData, i * 4 + 2).rgb;
+        vec3 atten = texelFetch(lightData, i * 4 + 3).xyz;
+
+        vec3 Ldir = lpos - pos;
+        float dist = length(Ldir);
+        Ldir /= dist;
+
+        float diff = max(dot(nor, Ldir), 0.0);
+        result += albedo * diff * color * distanceFalloff(atten, dist);
+    }
+
+    for (int k = tile.x + tile.y; k < tile.x + tile.y + tile.z; k++) {
+        int i = texelFetch(tileIndices, k).x;
+        vec4 t0    = texelFetch(lightData, i * 4 + 0);
+        vec4 t1    = texelFetch(lightData, i * 4 + 1);
+        vec3 color = texelFetch(lightData, i * 4 + 2).rgb;
+        vec3 atten = texelFetch(lightData, i * 4 + 3).xyz;
+
+        vec3 Ldir = t0.xyz - pos;
+        float dist = length(Ldir);
+        Ldir /= dist;
+
+        float angleToAxis = acos(clamp(dot(-Ldir, normalize(t1.xyz)), -1.0, 1.0));
+        float falloff = distanceFalloff(atten, dist) * spotFalloff(angleToAxis, t0.w, t1.w);
+
+        float diff = max(dot(nor, Ldir), 0.0);
+        result += albedo * diff * color * falloff;
+    }
+
+    fragColor = vec4(result, 1.0);
+    brightColor = vec4(brightPass(result), 1.0);
+}
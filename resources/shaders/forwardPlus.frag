@@ -0,0 +1,146 @@
+#version 330 core
+
+// Inputs from gbuffer.vert (world-space)
+in vec3 vPos;
+in vec3 vNor;
+flat in int vMaterial;
+
+layout(location = 0) out vec4 fragColor;
+// Bright-pass for bloom; dropped when rendering straight to the backbuffer
+layout(location = 1) out vec4 brightColor;
+
+uniform float bloomThreshold; // luminance
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    mat4 invViewProj;
+    vec4 camPos;
+} frame;
+
+// -------- Global coefficients --------
+uniform float k_a;
+uniform float k_d;
+uniform float k_s;
+
+// MaterialTable: 4 texels per material (ambient, diffuse, specular + shininess, emissive)
+uniform samplerBuffer materials;
+
+// LightBuffer: 4 texels per light, sorted directional, point, spot
+//   [0] pos.xyz, angle  [1] dir.xyz, penumbra  [2] color.rgb  [3] atten.xyz
+uniform samplerBuffer lightData;
+uniform int numDirectional;
+
+// ClusterLightGrid: per froxel (offset, numPoint, numSpot, pad) into
+// clusterIndices, which holds light indices with points before spots
+uniform isamplerBuffer clusters;
+uniform isamplerBuffer clusterIndices;
+uniform ivec3 clusterDims;
+uniform vec2 clusterScale;   // clusterDims.xy / viewport size in pixels
+uniform vec2 sliceParams;    // (near, clusterDims.z / log(far / near))
+
+// Material, looked up once per fragment
+vec3 cDiffuse;
+vec3 cSpecular;
+float shininess;
+
+// ================= Helper Functions =================
+
+// Distance attenuation: 1 / (a + b*d + c*d^2), clamped to [0,1]
+float distanceFalloff(vec3 coeffs, float d) {
+    float denom = coeffs.x + d * (coeffs.y + coeffs.z * d);
+    return min(1.0, 1.0 / max(denom, 1e-6));
+}
+
+// Smooth spotlight falloff between inner & outer angle
+float spotFalloff(float angleToAxis, float outerAngle, float penumbra) {
+    float inner = outerAngle - penumbra;
+    if (angleToAxis <= inner) return 1.0;
+    if (angleToAxis >= outerAngle) return 0.0;
+
+    float t = (angleToAxis - inner) / (outerAngle - inner);
+    return 1.0 - t * t * (3.0 - 2.0 * t);
+}
+
+// Diffuse + specular (Phong) for one light, as in default.frag
+vec3 phong(vec3 L, vec3 color, float attenuation, vec3 N, vec3 V) {
+    float NdotL = max(dot(N, L), 0.0);
+    if (NdotL <= 0.0) {
+        return vec3(0.0);
+    }
+
+    vec3 diffuse = k_d * cDiffuse * NdotL * color;
+
+    vec3 specular = vec3(0.0);
+    if (shininess > 0.0 && k_s > 0.0) {
+        vec3 R = reflect(-L, N);
+        specular = k_s * cSpecular * pow(max(dot(R, V), 0.0), shininess) * color;
+    }
+
+    return attenuation * (diffuse + specular);
+}
+
+// Part of the colour above the bloom threshold
+vec3 brightPass(vec3 c) {
+    float luminance = dot(c, vec3(0.2126, 0.7152, 0.0722));
+    return c * (max(luminance - bloomThreshold, 0.0) / max(luminance, 1e-4));
+}
+
+// ================= Main Shader =================
+
+void main() {
+    vec3 cAmbient  = texelFetch(materials, vMaterial * 4 + 0).rgb;
+    cDiffuse       = texelFetch(materials, vMaterial * 4 + 1).rgb;
+    vec4 spec      = texelFetch(materials, vMaterial * 4 + 2);
+    vec3 cEmissive = texelFetch(materials, vMaterial * 4 + 3).rgb;
+    cSpecular = spec.rgb;
+    shininess = spec.w;
+
+    vec3 N = normalize(vNor);
+    vec3 V = normalize(frame.camPos.xyz - vPos);
+
+    vec3 color = k_a * cAmbient + cEmissive;
+
+    // Directional lights reach every fragment and are not clustered
+    for (int i = 0; i < numDirectional; i++) {
+        vec3 dir   = texelFetch(lightData, i * 4 + 1).xyz;
+        vec3 lc    = texelFetch(lightData, i * 4 + 2).rgb;
+        color += phong(normalize(-dir), lc, 1.0, N, V);
+    }
+
+    float viewDist = -(frame.view * vec4(vPos, 1.0)).z;
+    int slice = clamp(int(floor(log(viewDist / sliceParams.x) * sliceParams.y)), 0, clusterDims.z - 1);
+    ivec2 xy = min(ivec2(gl_FragCoord.xy * clusterScale), clusterDims.xy - 1);
+    ivec4 cluster = texelFetch(clusters, (slice * clusterDims.y + xy.y) * clusterDims.x + xy.x);
+
+    for (int k = cluster.x; k < cluster.x + cluster.y; k++) {
+        int i = texelFetch(clusterIndices, k).x;
+        vec3 lpos  = texelFetch(lightData, i * 4 + 0).xyz;
+        vec3 lc    = texelFetch(lightData, i * 4 + 2).rgb;
+        vec3 atten = texelFetch(lightData, i * 4 + 3).xyz;
+
+        vec3 L = lpos - vPos;
+        float dist = length(L);
+        color += phong(L / dist, lc, distanceFalloff(atten, dist), N, V);
+    }
+
+    for (int k = cluster.x + cluster.y; k < cluster.x + cluster.y + cluster.z; k++) {
+        int i = texelFetch(clusterIndices, k).x;
+        vec4 t0    = texelFetch(lightData, i * 4 + 0);
+        vec4 t1    = texelFetch(lightData, i * 4 + 1);
+        vec3 lc    = texelFetch(lightData, i * 4 + 2).rgb;
+        vec3 atten = texelFetch(lightData, i * 4 + 3).xyz;
+
+        vec3 L = t0.xyz - vPos;
+        float dist = length(L);
+        L /= dist;
+
+        float angleToAxis = acos(clamp(dot(-L, normalize(t1.xyz)), -1.0, 1.0));
+        float falloff = distanceFalloff(atten, dist) * spotFalloff(angleToAxis, t0.w, t1.w);
+        color += phong(L, lc, falloff, N, V);
+    }
+
+    fragColor = vec4(color, 1.0);
+    brightColor = vec4(brightPass(color), 1.0);
+}
@@ -1,19 +1,34 @@
 #version 330 core
 
-layout(location = 0) out vec4 oPosition;
-layout(location = 1) out vec4 oNormal;
-layout(location = 2) out vec4 oAlbedo;
-layout(location = 3) out vec4 oEmissive;
+// Position is not written; lighting reconstructs it from the depth buffer.
+// oEmissive is dropped when the G-buffer has no emissive attachment.
+layout(location = 0) out vec2 oNormal;
+layout(location = 1) out vec4 oAlbedo;
+layout(location = 2) out vec4 oEmissive;
 
 in vec3 vPos;
 in vec3 vNor;
+flat in int vMaterial;
 
-uniform vec3 cDiffuse;
-uniform vec3 cEmissive;
+// MaterialTable: 4 texels per material (ambient, diffuse, specular, emissive)
+uniform samplerBuffer materials;
+uniform float k_d; // the scene's global diffuse coefficient, folded into the albedo
+
+// Octahedral normal encoding into [0,1]^2 for an RG16 target
+vec2 encodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 e = n.xy;
+    if (n.z < 0.0) {
+        e = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return e * 0.5 + 0.5;
+}
 
 void main() {
-    oPosition = vec4(vPos, 1.0);
-    oNormal = vec4(normalize(vNor), 1.0);
-    oAlbedo = vec4(cDiffuse, 1.0);
+    vec3 cDiffuse = texelFetch(materials, vMaterial * 4 + 1).rgb;
+    vec3 cEmissive = texelFetch(materials, vMaterial * 4 + 3).rgb;
+
+    oNormal = encodeNormal(normalize(vNor));
+    oAlbedo = vec4(k_d * cDiffuse, 1.0);
     oEmissive = vec4(cEmissive, 1.0);
 }
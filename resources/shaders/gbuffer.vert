@@ -2,16 +2,26 @@
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNor;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 proj;
+// Per-instance attributes (divisor 1); the model matrix occupies locations 2-5
+layout(location = 2) in mat4 aModel;
+layout(location = 6) in int aMaterial;
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    mat4 invViewProj;
+    vec4 camPos;
+} frame;
 
 out vec3 vPos;
 out vec3 vNor;
+flat out int vMaterial;
 
 void main() {
-    vec4 wp = model * vec4(aPos, 1.0);
+    vec4 wp = aModel * vec4(aPos, 1.0);
     vPos = wp.xyz;
-    vNor = mat3(model) * aNor;
-    gl_Position = proj * view * wp;
+    vNor = mat3(aModel) * aNor;
+    vMaterial = aMaterial;
+    gl_Position = frame.viewProj * wp;
 }
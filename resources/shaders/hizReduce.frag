@@ -0,0 +1,23 @@
+#version 330 core
+
+// Rendered into a target with one pixel per blockSize x blockSize block of the
+// depth buffer; writes the block's farthest window depth, the base level of the
+// Hi-Z pyramid (see HiZBuffer)
+out float fragDepth;
+
+uniform sampler2D depthTex;
+uniform int blockSize;
+
+void main() {
+    ivec2 size = textureSize(depthTex, 0);
+    ivec2 origin = ivec2(gl_FragCoord.xy) * blockSize;
+    ivec2 end = min(origin + ivec2(blockSize), size);
+
+    float depth = 0.0;
+    for (int y = origin.y; y < end.y; y++) {
+        for (int x = origin.x; x < end.x; x++) {
+            depth = max(depth, texelFetch(depthTex, ivec2(x, y), 0).r);
+        }
+    }
+    fragDepth = depth;
+}
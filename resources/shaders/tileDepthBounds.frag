@@ -0,0 +1,39 @@
+#version 330 core
+
+// Rendered into a target with one pixel per lighting tile; writes the tile's
+// (min, max) view distance over covered G-buffer pixels, or (+big, -big) if empty
+out vec2 fragBounds;
+
+uniform sampler2D gDepth;
+uniform int tileSize;
+
+layout(std140) uniform FrameData {
+    mat4 view;
+    mat4 proj;
+    mat4 viewProj;
+    mat4 invViewProj;
+    vec4 camPos;
+} frame;
+
+void main() {
+    ivec2 size = textureSize(gDepth, 0);
+    ivec2 origin = ivec2(gl_FragCoord.xy) * tileSize;
+    ivec2 end = min(origin + ivec2(tileSize), size);
+
+    float zMin = 1e30;
+    float zMax = -1e30;
+    for (int y = origin.y; y < end.y; y++) {
+        for (int x = origin.x; x < end.x; x++) {
+            float d = texelFetch(gDepth, ivec2(x, y), 0).r;
+            // Background pixels keep the cleared depth of 1
+            if (d == 1.0) continue;
+
+            // Invert ndc.z = (P22 * z + P32) / -z for the view distance -z
+            float z = frame.proj[3][2] / (d * 2.0 - 1.0 + frame.proj[2][2]);
+            zMin = min(zMin, z);
+            zMax = max(zMax, z);
+        }
+    }
+
+    fragBounds = vec2(zMin, zMax);
+}
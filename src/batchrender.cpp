@@ -0,0 +1,224 @@
+// Renders scene files to PNG without opening a window. Every worker thread owns
+// an offscreen surface, a GL context and a SceneRenderer, and takes the next
+// scene from a shared counter until none are left.
+//
+//   batch_render -o out -j 8 --width 1024 --height 768 scenefiles/realtime
+//
+// Directories are searched recursively for .json scenes and keep their layout
+// under the output directory. With no display, run on Mesa's llvmpipe through
+// EGL, e.g. QT_QPA_PLATFORM=eglfs LIBGL_ALWAYS_SOFTWARE=1.
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QSurfaceFormat>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "settings.h"
+#include "utils/offscreenrenderer.h"
+
+namespace {
+
+struct Job {
+    QString scene;  // scene file
+    QString output; // PNG path
+};
+
+struct Options {
+    int width = 800;
+    int height = 600;
+    QString outputDir = ".";
+    int param1 = 1;
+    int param2 = 1;
+    int jobs = 1;
+};
+
+std::mutex g_logMutex;
+
+void report(const QString& line) {
+    std::lock_guard<std::mutex> lock(g_logMutex);
+    std::cout << line.toStdString() << std::endl;
+}
+
+// Every .json under each input, paired with where its PNG goes
+std::vector<Job> collectJobs(const QStringList& inputs, const QDir& outputDir) {
+    std::vector<Job> jobs;
+    for (const QString& input : inputs) {
+        QFileInfo info(input);
+        if (!info.isDir()) {
+            jobs.push_back({input, outputDir.filePath(info.completeBaseName() + ".png")});
+            continue;
+        }
+
+        QDir root(input);
+        QDirIterator it(input, {"*.json"}, QDir::Files, QDirIterator::Subdirectories);
+        QStringList scenes;
+        while (it.hasNext()) scenes << it.next();
+        scenes.sort();
+        for (const QString& scene : scenes) {
+            QString relative = root.relativeFilePath(scene);
+            relative.chop(QFileInfo(scene).suffix().size());
+            jobs.push_back({scene, outputDir.filePath(relative + "png")});
+        }
+    }
+    return jobs;
+}
+
+// Renders jobs on the calling thread with its own context until the counter runs out
+// @return number of PNGs written
+int renderJobs(QOpenGLContext* context, QOffscreenSurface* surface, const Options& options,
+               const std::vector<Job>& jobs, std::atomic<size_t>& next) {
+    if (!context->makeCurrent(surface)) {
+        report("Could not make the GL context current");
+        return 0;
+    }
+
+    std::string error;
+    if (!OffscreenRenderer::initGL(error)) {
+        report(QString("glewInit failed: ") + QString::fromStdString(error));
+        return 0;
+    }
+
+    OffscreenRenderer renderer;
+    renderer.init(options.width, options.height);
+
+    int rendered = 0;
+    for (size_t i = next++; i < jobs.size(); i = next++) {
+        const Job& job = jobs[i];
+        QElapsedTimer timer;
+        timer.start();
+
+        RenderData scene;
+        if (!SceneParser::parse(job.scene.toStdString(), scene)) {
+            report("Failed to parse " + job.scene);
+            continue;
+        }
+        renderer.setScene(scene, options.param1, options.param2);
+        renderer.render();
+
+        QDir().mkpath(QFileInfo(job.output).path());
+        if (!renderer.readback().save(job.output)) {
+            report("Failed to write " + job.output);
+            continue;
+        }
+        rendered++;
+        report(QString("%1 -> %2 (%3 ms)").arg(job.scene, job.output).arg(timer.elapsed()));
+    }
+
+    renderer.destroy();
+    context->doneCurrent();
+    return rendered;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    // No window is ever shown, so default to the platform that needs no display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    QCoreApplication::setApplicationName("batch_render");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders scene files to PNG without a window.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("scenes", "Scene files, or directories searched for .json scenes.", "scenes...");
+    QCommandLineOption outputOpt({"o", "output"}, "Directory for the PNGs (default: current).", "dir", ".");
+    QCommandLineOption widthOpt("width", "Image width in pixels (default: 800).", "px", "800");
+    QCommandLineOption heightOpt("height", "Image height in pixels (default: 600).", "px", "600");
+    QCommandLineOption param1Opt("param1", "Tessellation parameter 1 (default: 1).", "n", "1");
+    QCommandLineOption param2Opt("param2", "Tessellation parameter 2 (default: 1).", "n", "1");
+    QCommandLineOption pipelineOpt("pipeline", "deferred, tiled or forward (default: deferred).", "name", "deferred");
+    QCommandLineOption bloomOpt("bloom", "Enable bloom.");
+    QCommandLineOption jobsOpt({"j", "jobs"}, "Scenes rendered in parallel, one GL context each "
+                                              "(default: number of cores).", "n",
+                               QString::number(QThread::idealThreadCount()));
+    parser.addOptions({outputOpt, widthOpt, heightOpt, param1Opt, param2Opt, pipelineOpt, bloomOpt, jobsOpt});
+    parser.process(app);
+
+    Options options;
+    options.width = std::max(parser.value(widthOpt).toInt(), 1);
+    options.height = std::max(parser.value(heightOpt).toInt(), 1);
+    options.outputDir = parser.value(outputOpt);
+
+    options.param1 = std::max(parser.value(param1Opt).toInt(), 1);
+    options.param2 = std::max(parser.value(param2Opt).toInt(), 1);
+
+    // Read-only once the workers start
+    settings.bloom = parser.isSet(bloomOpt);
+    QString pipeline = parser.value(pipelineOpt);
+    if (pipeline == "deferred") settings.lightingPipeline = LightingPipeline::Deferred;
+    else if (pipeline == "tiled") settings.lightingPipeline = LightingPipeline::TiledDeferred;
+    else if (pipeline == "forward") settings.lightingPipeline = LightingPipeline::ForwardPlus;
+    else {
+        std::cerr << "Unknown pipeline \"" << pipeline.toStdString() << "\"" << std::endl;
+        return 1;
+    }
+
+    QDir outputDir(options.outputDir);
+    std::vector<Job> jobs = collectJobs(parser.positionalArguments(), outputDir);
+    if (jobs.empty()) parser.showHelp(1);
+    options.jobs = std::clamp(parser.value(jobsOpt).toInt(), 1, int(jobs.size()));
+
+    QSurfaceFormat fmt;
+    fmt.setVersion(4, 1);
+    fmt.setProfile(QSurfaceFormat::CoreProfile);
+    QSurfaceFormat::setDefaultFormat(fmt);
+
+    // Surfaces must be created on the GUI thread; each context then moves to its worker
+    struct Worker {
+        std::unique_ptr<QOffscreenSurface> surface;
+        std::unique_ptr<QOpenGLContext> context;
+        QThread* thread = nullptr;
+        int rendered = 0;
+    };
+    std::vector<Worker> workers(options.jobs);
+    std::atomic<size_t> next{0};
+
+    QElapsedTimer total;
+    total.start();
+    // Every context exists before any worker starts, so a failure leaves nothing running
+    for (Worker& w : workers) {
+        w.surface = std::make_unique<QOffscreenSurface>();
+        w.surface->setFormat(fmt);
+        w.surface->create();
+        w.context = std::make_unique<QOpenGLContext>();
+        w.context->setFormat(fmt);
+        if (!w.context->create()) {
+            std::cerr << "Could not create a GL 4.1 core context" << std::endl;
+            return 1;
+        }
+    }
+    for (Worker& w : workers) {
+        w.thread = QThread::create([&w, &options, &jobs, &next] {
+            w.rendered = renderJobs(w.context.get(), w.surface.get(), options, jobs, next);
+        });
+        w.context->moveToThread(w.thread);
+        w.thread->start();
+    }
+
+    size_t rendered = 0;
+    for (Worker& w : workers) {
+        w.thread->wait();
+        delete w.thread;
+        rendered += w.rendered;
+    }
+
+    std::cout << rendered << "/" << jobs.size() << " scenes rendered with "
+              << workers.size() << " contexts in " << total.elapsed() << " ms" << std::endl;
+    return rendered == jobs.size() ? 0 : 1;
+}
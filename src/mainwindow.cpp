@@ -30,6 +30,9 @@ void MainWindow::initialize() {
     QLabel *camera_label = new QLabel(); // Camera label
     camera_label->setText("Camera");
     camera_label->setFont(font);
+    QLabel *rendering_label = new QLabel(); // Rendering label
+    rendering_label->setText("Rendering");
+    rendering_label->setFont(font);
 
     // From old Project 6
     // QLabel *filters_label = new QLabel(); // Filters label
@@ -66,6 +69,9 @@ void MainWindow::initialize() {
     saveImage = new QPushButton();
     saveImage->setText(QStringLiteral("Save Image"));
 
+    loadStatus = new QLabel();
+    loadStatus->setText("No scene loaded");
+
     // Creates the boxes containing the parameter sliders and number boxes
     QGroupBox *p1Layout = new QGroupBox(); // horizonal slider 1 alignment
     QHBoxLayout *l1 = new QHBoxLayout();
@@ -146,6 +152,39 @@ void MainWindow::initialize() {
     lfar->addWidget(farBox);
     farLayout->setLayout(lfar);
 
+    // Items are in LightingPipeline order
+    pipelineBox = new QComboBox();
+    pipelineBox->addItem(QStringLiteral("Deferred"));
+    pipelineBox->addItem(QStringLiteral("Tiled Deferred"));
+    pipelineBox->addItem(QStringLiteral("Clustered Forward+"));
+
+    bloomBox = new QCheckBox();
+    bloomBox->setText(QStringLiteral("Bloom"));
+    bloomBox->setChecked(settings.bloom);
+
+    profilerBox = new QCheckBox();
+    profilerBox->setText(QStringLiteral("GPU Profiler HUD"));
+    profilerBox->setChecked(settings.profilerHud);
+
+    continuousBox = new QCheckBox();
+    continuousBox->setText(QStringLiteral("Continuous Rendering"));
+    continuousBox->setChecked(settings.continuousRendering);
+
+    cullingBox = new QCheckBox();
+    cullingBox->setText(QStringLiteral("Frustum Culling"));
+    cullingBox->setChecked(settings.frustumCulling);
+
+    smallCullingBox = new QCheckBox();
+    smallCullingBox->setText(QStringLiteral("Cull Sub-Pixel Shapes"));
+    smallCullingBox->setChecked(settings.smallObjectCulling);
+
+    occlusionBox = new QCheckBox();
+    occlusionBox->setText(QStringLiteral("Occlusion Culling (Hi-Z)"));
+    occlusionBox->setChecked(settings.occlusionCulling);
+
+    saveProfile = new QPushButton();
+    saveProfile->setText(QStringLiteral("Save GPU Profile"));
+
     // Extra Credit:
     ec1 = new QCheckBox();
     ec1->setText(QStringLiteral("Extra Credit 1"));
@@ -165,6 +204,7 @@ void MainWindow::initialize() {
 
     vLayout->addWidget(uploadFile);
     vLayout->addWidget(saveImage);
+    vLayout->addWidget(loadStatus);
     vLayout->addWidget(tesselation_label);
     vLayout->addWidget(param1_label);
     vLayout->addWidget(p1Layout);
@@ -175,6 +215,15 @@ void MainWindow::initialize() {
     vLayout->addWidget(nearLayout);
     vLayout->addWidget(far_label);
     vLayout->addWidget(farLayout);
+    vLayout->addWidget(rendering_label);
+    vLayout->addWidget(pipelineBox);
+    vLayout->addWidget(bloomBox);
+    vLayout->addWidget(profilerBox);
+    vLayout->addWidget(continuousBox);
+    vLayout->addWidget(cullingBox);
+    vLayout->addWidget(smallCullingBox);
+    vLayout->addWidget(occlusionBox);
+    vLayout->addWidget(saveProfile);
 
     // From old Project 6
     // vLayout->addWidget(filters_label);
@@ -214,6 +263,7 @@ void MainWindow::connectUIElements() {
     connectParam2();
     connectNear();
     connectFar();
+    connectPipeline();
     connectExtraCredit();
 }
 
@@ -228,6 +278,12 @@ void MainWindow::connectUIElements() {
 
 void MainWindow::connectUploadFile() {
     connect(uploadFile, &QPushButton::clicked, this, &MainWindow::onUploadFile);
+
+    // Queued across threads automatically, so the label is only touched on the GUI thread
+    connect(this, &MainWindow::sceneLoadProgress, this, &MainWindow::onSceneLoadProgress);
+    realtime->setLoadProgressCallback([this](const std::string &stage, int percent) {
+        emit sceneLoadProgress(QString::fromStdString(stage), percent);
+    });
 }
 
 void MainWindow::connectSaveImage() {
@@ -258,6 +314,18 @@ void MainWindow::connectFar() {
             this, &MainWindow::onValChangeFarBox);
 }
 
+void MainWindow::connectPipeline() {
+    connect(pipelineBox, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onPipelineChanged);
+    connect(bloomBox, &QCheckBox::clicked, this, &MainWindow::onBloomChanged);
+    connect(profilerBox, &QCheckBox::clicked, this, &MainWindow::onProfilerHudChanged);
+    connect(continuousBox, &QCheckBox::clicked, this, &MainWindow::onContinuousRenderingChanged);
+    connect(cullingBox, &QCheckBox::clicked, this, &MainWindow::onFrustumCullingChanged);
+    connect(smallCullingBox, &QCheckBox::clicked, this, &MainWindow::onSmallObjectCullingChanged);
+    connect(occlusionBox, &QCheckBox::clicked, this, &MainWindow::onOcclusionCullingChanged);
+    connect(saveProfile, &QPushButton::clicked, this, &MainWindow::onSaveProfile);
+}
+
 void MainWindow::connectExtraCredit() {
     connect(ec1, &QCheckBox::clicked, this, &MainWindow::onExtraCredit1);
     connect(ec2, &QCheckBox::clicked, this, &MainWindow::onExtraCredit2);
@@ -318,6 +386,10 @@ void MainWindow::onSaveImage() {
     realtime->saveViewportImage(filePath.toStdString());
 }
 
+void MainWindow::onSceneLoadProgress(const QString &stage, int percent) {
+    loadStatus->setText(stage + QString(" (") + QString::number(percent) + QString("%)"));
+}
+
 void MainWindow::onValChangeP1(int newValue) {
     p1Slider->setValue(newValue);
     p1Box->setValue(newValue);
@@ -360,6 +432,52 @@ void MainWindow::onValChangeFarBox(double newValue) {
     realtime->settingsChanged();
 }
 
+void MainWindow::onPipelineChanged(int index) {
+    settings.lightingPipeline = LightingPipeline(index);
+    realtime->update();
+}
+
+void MainWindow::onBloomChanged() {
+    settings.bloom = !settings.bloom;
+    realtime->update();
+}
+
+void MainWindow::onProfilerHudChanged() {
+    settings.profilerHud = !settings.profilerHud;
+    realtime->update();
+}
+
+void MainWindow::onContinuousRenderingChanged() {
+    settings.continuousRendering = !settings.continuousRendering;
+    realtime->update();
+}
+
+void MainWindow::onFrustumCullingChanged() {
+    settings.frustumCulling = !settings.frustumCulling;
+    realtime->update();
+}
+
+void MainWindow::onSmallObjectCullingChanged() {
+    settings.smallObjectCulling = !settings.smallObjectCulling;
+    realtime->update();
+}
+
+void MainWindow::onOcclusionCullingChanged() {
+    settings.occlusionCulling = !settings.occlusionCulling;
+    realtime->update();
+}
+
+void MainWindow::onSaveProfile() {
+    QString filePath = QFileDialog::getSaveFileName(this, tr("Save GPU Profile"),
+                                                    QDir::currentPath()
+                                                        .append(QDir::separator())
+                                                        .append("gpu_profile.csv"),
+                                                    tr("CSV Files (*.csv);;JSON Files (*.json)"));
+    if (filePath.isEmpty()) return;
+    std::cout << "Saving GPU profile to: \"" << filePath.toStdString() << "\"." << std::endl;
+    realtime->saveGpuProfile(filePath.toStdString());
+}
+
 // Extra Credit:
 
 void MainWindow::onExtraCredit1() {
@@ -2,10 +2,12 @@
 
 #include <QMainWindow>
 #include <QCheckBox>
+#include <QComboBox>
 #include <QSlider>
 #include <QSpinBox>
 #include <QDoubleSpinBox>
 #include <QPushButton>
+#include <QLabel>
 #include "realtime.h"
 #include "utils/aspectratiowidget/aspectratiowidget.hpp"
 
@@ -17,12 +19,17 @@ public:
     void initialize();
     void finish();
 
+signals:
+    // Emitted from the loader thread as well as the GUI thread while a scene loads
+    void sceneLoadProgress(const QString &stage, int percent);
+
 private:
     void connectUIElements();
     void connectParam1();
     void connectParam2();
     void connectNear();
     void connectFar();
+    void connectPipeline();
 
     // From old Project 6
     // void connectPerPixelFilter();
@@ -41,6 +48,7 @@ private:
 
     QPushButton *uploadFile;
     QPushButton *saveImage;
+    QLabel *loadStatus;
     QSlider *p1Slider;
     QSlider *p2Slider;
     QSpinBox *p1Box;
@@ -49,6 +57,14 @@ private:
     QSlider *farSlider;
     QDoubleSpinBox *nearBox;
     QDoubleSpinBox *farBox;
+    QComboBox *pipelineBox;
+    QCheckBox *bloomBox;
+    QCheckBox *profilerBox;
+    QCheckBox *continuousBox;
+    QCheckBox *cullingBox;
+    QCheckBox *smallCullingBox;
+    QCheckBox *occlusionBox;
+    QPushButton *saveProfile;
 
     // Extra Credit:
     QCheckBox *ec1;
@@ -63,12 +79,21 @@ private slots:
 
     void onUploadFile();
     void onSaveImage();
+    void onSceneLoadProgress(const QString &stage, int percent);
     void onValChangeP1(int newValue);
     void onValChangeP2(int newValue);
     void onValChangeNearSlider(int newValue);
     void onValChangeFarSlider(int newValue);
     void onValChangeNearBox(double newValue);
     void onValChangeFarBox(double newValue);
+    void onPipelineChanged(int index);
+    void onBloomChanged();
+    void onProfilerHudChanged();
+    void onContinuousRenderingChanged();
+    void onFrustumCullingChanged();
+    void onSmallObjectCullingChanged();
+    void onOcclusionCullingChanged();
+    void onSaveProfile();
 
     // Extra Credit:
     void onExtraCredit1();
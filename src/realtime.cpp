@@ -4,11 +4,12 @@
 
 #include <QMouseEvent>
 #include <QKeyEvent>
+#include <QPainter>
 #include "settings.h"
-#include "utils/cube.h"
-#include "utils/cone.h"
-#include "utils/cylinder.h"
-#include "utils/sphere.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
 
 
 
@@ -17,146 +18,190 @@ Realtime::Realtime(QWidget* parent)
     m_camPos = glm::vec3(0,0,5);
     m_camDir = glm::vec3(0,0,-1);
     m_camUp  = glm::vec3(0,1,0);
+    m_mouseDown = false;
 }
 
 void Realtime::initializeGL() {
     glewInit();
     m_dpr = devicePixelRatio();
-    gbuffer.init(width()*m_dpr, height()*m_dpr);
-    deferred.init();
-    m_timer = startTimer(16);
+    m_renderer.init(width()*m_dpr, height()*m_dpr);
 }
 
 void Realtime::paintGL() {
-    renderGeometryPass();
-    deferred.render(&gbuffer, m_renderData.lights, m_camPos);
-}
+    uploadLoadedScene();
+    m_renderer.render(m_camera.getViewMatrix(), m_camera.getProjMatrix(), m_camPos, defaultFramebufferObject());
 
-void Realtime::resizeGL(int w, int h) {
-    gbuffer.init(w*m_dpr, h*m_dpr);
-    float aspect = float(w)/float(h);
-    m_camera.setProjectionMatrix(aspect, 0.1f, 100.f, m_renderData.cameraData.heightAngle);
+    const FrameGraph& graph = m_renderer.graph();
+    if (graph.layoutHash() != m_graphLayout) {
+        m_graphLayout = graph.layoutHash();
+        std::cout << graph.dump();
+    }
+    if (settings.profilerHud) paintProfilerHud();
+
+    scheduleFrames();
 }
 
-void Realtime::loadScene() {
-    SceneParser::parse(settings.sceneFilePath, m_renderData);
+void Realtime::scheduleFrames() {
+    // Uploads are budgeted per frame, so a load in flight needs frames to finish
+    // and occlusion and tiled light culling need frames until their depth
+    // readbacks catch up with the camera
+    bool animating = settings.continuousRendering || m_loader.isLoading() || m_renderer.needsRefresh();
+    if (animating && !m_timer) {
+        m_timer = startTimer(16);
+    } else if (!animating && m_timer) {
+        killTimer(m_timer);
+        m_timer = 0;
+    }
+}
 
-    glm::vec3 pos = glm::vec3(m_renderData.cameraData.pos);
-    glm::vec3 look = glm::vec3(m_renderData.cameraData.look);
-    glm::vec3 up = glm::normalize(glm::vec3(m_renderData.cameraData.up));
+void Realtime::paintProfilerHud() {
+    const GpuProfiler& profiler = m_renderer.profiler();
+    const std::deque<GpuProfiler::Frame>& history = profiler.history();
+    const std::vector<std::string>& names = profiler.names();
+    if (history.empty()) return;
+
+    // Scale to the slowest sample, but never below a 60 Hz frame
+    const float budgetMs = 1000.f / 60.f;
+    float maxMs = budgetMs;
+    for (const GpuProfiler::Frame& f : history) {
+        for (float ms : f.ms) maxMs = std::max(maxMs, ms);
+    }
 
-    m_camPos = pos;
-    m_camDir = glm::normalize(look - pos);
-    m_camUp = up;
+    QPainter painter(this);
+    painter.setRenderHint(QPainter::Antialiasing);
+    QFontMetrics metrics = painter.fontMetrics();
+    int lineHeight = metrics.height();
+
+    QRectF graph(10, 10, 360, 120);
+    QRectF panel = graph.adjusted(-6, -6, 6, 12 + lineHeight * int(names.size() + 3));
+    painter.fillRect(panel, QColor(0, 0, 0, 160));
+
+    auto toY = [&](float ms) { return graph.bottom() - graph.height() * ms / maxMs; };
+    painter.setPen(QPen(QColor(255, 255, 255, 90), 1, Qt::DashLine));
+    painter.drawLine(QPointF(graph.left(), toY(budgetMs)), QPointF(graph.right(), toY(budgetMs)));
+
+    for (int id = 0; id < int(names.size()); id++) {
+        QColor color = QColor::fromHsv((id * 67) % 360, 190, 255);
+
+        // Newest sample sits at the right edge
+        QPolygonF line;
+        int offset = GpuProfiler::HISTORY - int(history.size());
+        for (int i = 0; i < int(history.size()); i++) {
+            const std::vector<float>& ms = history[i].ms;
+            float x = graph.left() + graph.width() * float(offset + i) / (GpuProfiler::HISTORY - 1);
+            line << QPointF(x, toY(id < int(ms.size()) ? ms[id] : 0.f));
+        }
+        painter.setPen(QPen(color, 1.5));
+        painter.drawPolyline(line);
 
-    float aspect = float(width()) / float(height());
-    m_camera.setViewMatrix(m_camPos, m_camDir, m_camUp);
-    m_camera.setProjectionMatrix(aspect, 0.1f, 100.f, m_renderData.cameraData.heightAngle);
+        QString label = QString("%1  %2 ms").arg(QString::fromStdString(names[id]))
+                                              .arg(profiler.average(id), 0, 'f', 3);
+        painter.drawText(QPointF(graph.left(), graph.bottom() + 8 + lineHeight * (id + 1) - metrics.descent()), label);
+    }
 
-    generateShapeVAOs();
+    const SceneRenderer::Stats& stats = m_renderer.stats();
+    painter.setPen(QColor(255, 255, 255));
+    painter.drawText(QPointF(graph.left(), graph.bottom() + 8 + lineHeight * int(names.size() + 1) - metrics.descent()),
+                     QString("%1 draws  %2 shapes  %3 culled  %4 occluded  %5 MiB targets")
+                         .arg(stats.drawCalls).arg(stats.instances).arg(stats.culled).arg(stats.occluded)
+                         .arg(m_renderer.renderTargets().bytesAllocated() / double(1 << 20), 0, 'f', 1));
+    const GLState::Stats& gl = m_renderer.glStats();
+    painter.drawText(QPointF(graph.left(), graph.bottom() + 8 + lineHeight * int(names.size() + 2) - metrics.descent()),
+                     QString("GL: %1 draws  %2 binds (%3 skipped)  %4 uniforms  %5 uploads  %6 KB")
+                         .arg(gl.drawCalls).arg(gl.stateChanges).arg(gl.redundant).arg(gl.uniformUploads)
+                         .arg(gl.bufferUploads).arg(int(gl.bufferBytes / 1024)));
+    QString selection = "Selected: none (click a shape)";
+    if (m_selectedShape >= 0) {
+        selection = QString("Selected: shape %1 at (%2, %3, %4)").arg(m_selectedShape)
+                        .arg(m_selectedPoint.x, 0, 'f', 2).arg(m_selectedPoint.y, 0, 'f', 2)
+                        .arg(m_selectedPoint.z, 0, 'f', 2);
+    }
+    painter.drawText(QPointF(graph.left(), graph.bottom() + 8 + lineHeight * int(names.size() + 3) - metrics.descent()),
+                     selection);
+    painter.end();
+
+    // QPainter leaves its own state behind; restore what the passes assume
+    glDisable(GL_BLEND);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glDepthMask(GL_TRUE);
+    glViewport(0, 0, m_renderer.width(), m_renderer.height());
 }
 
-void Realtime::generateShapeVAOs() {
-    cleanupVAOs();
-
-    for (auto &s : m_renderData.shapes) {
-
-        std::vector<float> data;
+void Realtime::resizeGL(int w, int h) {
+    m_renderer.resize(w*m_dpr, h*m_dpr);
+    float aspect = float(w)/float(h);
+    m_camera.setProjectionMatrix(aspect, 0.1f, 100.f, m_renderData.cameraData.heightAngle);
+}
 
-        switch (s.primitive.type) {
+void Realtime::uploadLoadedScene() {
+    if (!m_loader.isLoading()) return;
 
-        case PrimitiveType::PRIMITIVE_CUBE: {
-            Cube c;
-            c.updateParams(settings.shapeParameter1);  // ONLY 1 argument
-            data = c.generateShape();
-            break;
-        }
+    // The previous scene stays on screen until the new one is complete
+    QElapsedTimer budget;
+    budget.start();
 
-        case PrimitiveType::PRIMITIVE_SPHERE: {
-            Sphere sph;
-            sph.updateParams(settings.shapeParameter1, settings.shapeParameter2);
-            data = sph.generateShape();
+    std::unique_ptr<SceneLoader::Event> e;
+    while (budget.elapsed() < LOAD_BUDGET_MS && m_loader.poll(e)) {
+        switch (e->type) {
+        case SceneLoader::Event::Type::Mesh:
+            m_renderer.tessellation().adopt(e->key, std::move(e->mesh));
+            m_adoptedMeshes.push_back(e->key);
+            m_loader.reportProgress("Uploading", e->progress);
             break;
-        }
-
-        case PrimitiveType::PRIMITIVE_CYLINDER: {
-            Cylinder cyl;
-            cyl.updateParams(settings.shapeParameter1, settings.shapeParameter2);
-            data = cyl.generateShape();
+        case SceneLoader::Event::Type::Scene:
+            m_renderData = std::move(e->scene);
+            applyScene();
+            releaseAdoptedMeshes();
+            m_loader.reportProgress("Done", 100);
             break;
-        }
-
-        case PrimitiveType::PRIMITIVE_CONE: {
-            Cone cn;
-            cn.updateParams(settings.shapeParameter1, settings.shapeParameter2);
-            data = cn.generateShape();
+        case SceneLoader::Event::Type::Failed:
+            releaseAdoptedMeshes();
             break;
         }
-
-        default:
-            continue;
-        }
-
-        ShapeVAO V;
-        V.count = data.size() / 6;
-        V.ctm = s.ctm;
-        V.mat = s.primitive.material;
-
-        glGenVertexArrays(1, &V.vao);
-        glGenBuffers(1, &V.vbo);
-
-        glBindVertexArray(V.vao);
-        glBindBuffer(GL_ARRAY_BUFFER, V.vbo);
-
-        glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(float), data.data(), GL_STATIC_DRAW);
-
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void*)(3*sizeof(float)));
-        glEnableVertexAttribArray(1);
-
-        glBindVertexArray(0);
-
-        m_shapes.push_back(V);
     }
 }
 
+void Realtime::releaseAdoptedMeshes() {
+    // The scene's batches hold their own references by now; unused ones go at the next purge
+    for (const TessellationKey& key : m_adoptedMeshes) m_renderer.tessellation().release(key);
+    m_adoptedMeshes.clear();
+}
 
+void Realtime::applyScene() {
+    glm::vec3 pos = glm::vec3(m_renderData.cameraData.pos);
+    glm::vec3 look = glm::vec3(m_renderData.cameraData.look);
+    glm::vec3 up = glm::normalize(glm::vec3(m_renderData.cameraData.up));
 
+    m_camPos = pos;
+    m_camDir = glm::normalize(look - pos);
+    m_camUp = up;
 
-void Realtime::renderGeometryPass() {
-    gbuffer.bind();
-    glEnable(GL_DEPTH_TEST);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    GLuint s = deferred.shaderDeferred->id;
-    glUseProgram(s);
-
-    for (auto& V : m_shapes) {
-        glUniformMatrix4fv(glGetUniformLocation(s, "model"), 1, GL_FALSE, &V.ctm[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(s, "view"), 1, GL_FALSE, &m_camera.getViewMatrix()[0][0]);
-        glUniformMatrix4fv(glGetUniformLocation(s, "proj"), 1, GL_FALSE, &m_camera.getProjMatrix()[0][0]);
-
-        glm::vec3 cDiffuse = glm::vec3(V.mat.cDiffuse);
-        glm::vec3 cEmissive = glm::vec3(V.mat.cEmissive);
-
-        glUniform3fv(glGetUniformLocation(s, "cDiffuse"), 1, &cDiffuse[0]);
-        glUniform3fv(glGetUniformLocation(s, "cEmissive"), 1, &cEmissive[0]);
-
-        glBindVertexArray(V.vao);
-        glDrawArrays(GL_TRIANGLES, 0, V.count);
-    }
+    float aspect = float(width()) / float(height());
+    m_camera.setViewMatrix(m_camPos, m_camDir, m_camUp);
+    m_camera.setProjectionMatrix(aspect, 0.1f, 100.f, m_renderData.cameraData.heightAngle);
 
-    gbuffer.unbind();
+    m_renderer.setScene(m_renderData, settings.shapeParameter1, settings.shapeParameter2);
+    m_sceneBvh.build(m_renderData);
+    m_selectedShape = -1;
 }
 
-void Realtime::cleanupVAOs() {
-    for (auto& s : m_shapes) {
-        glDeleteBuffers(1, &s.vbo);
-        glDeleteVertexArrays(1, &s.vao);
+void Realtime::pickShape(const glm::vec2& pixel) {
+    // Unproject the pixel at the near and far planes
+    glm::vec2 ndc(2.f * pixel.x / width() - 1.f, 1.f - 2.f * pixel.y / height());
+    glm::mat4 inv = glm::inverse(m_camera.getProjMatrix() * m_camera.getViewMatrix());
+    glm::vec4 nearPoint = inv * glm::vec4(ndc, -1.f, 1.f);
+    glm::vec4 farPoint = inv * glm::vec4(ndc, 1.f, 1.f);
+    glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+    glm::vec3 dir = glm::vec3(farPoint) / farPoint.w - origin;
+
+    SceneBvh::Hit hit;
+    if (m_sceneBvh.raycast(origin, dir, hit)) {
+        m_selectedShape = int(hit.shape);
+        m_selectedPoint = hit.position;
+    } else {
+        m_selectedShape = -1;
     }
-    m_shapes.clear();
 }
 
 void Realtime::timerEvent(QTimerEvent*) {
@@ -164,15 +209,19 @@ void Realtime::timerEvent(QTimerEvent*) {
 }
 
 void Realtime::sceneChanged() {
-    makeCurrent();
-    loadScene();
-    doneCurrent();
+    m_loader.start(settings.sceneFilePath, settings.shapeParameter1, settings.shapeParameter2);
+    // Whatever the cancelled load adopted is no longer on its way to a scene
+    releaseAdoptedMeshes();
     update();
 }
 
+void Realtime::setLoadProgressCallback(SceneLoader::ProgressCallback callback) {
+    m_loader.setProgressCallback(std::move(callback));
+}
+
 void Realtime::settingsChanged() {
     makeCurrent();
-    generateShapeVAOs();
+    m_renderer.rebuildShapes(settings.shapeParameter1, settings.shapeParameter2);
     doneCurrent();
     update();
 }
@@ -182,10 +231,33 @@ void Realtime::saveViewportImage(const std::string& path) {
     img.save(QString::fromStdString(path));
 }
 
+void Realtime::saveGpuProfile(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "Could not write GPU profile to " << path << std::endl;
+        return;
+    }
+    bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+    if (json) m_renderer.profiler().writeJson(out);
+    else m_renderer.profiler().writeCsv(out);
+}
+
 
 void Realtime::keyPressEvent(QKeyEvent* e) {}
 void Realtime::keyReleaseEvent(QKeyEvent* e) {}
-void Realtime::mousePressEvent(QMouseEvent* e) {}
-void Realtime::mouseReleaseEvent(QMouseEvent* e) {}
+
+void Realtime::mousePressEvent(QMouseEvent* e) {
+    m_mouseDown = true;
+    m_prevMouse = glm::vec2(e->position().x(), e->position().y());
+    pickShape(m_prevMouse);
+    if (settings.profilerHud) update();
+}
+
+void Realtime::mouseReleaseEvent(QMouseEvent* e) {
+    m_mouseDown = false;
+}
+
 void Realtime::mouseMoveEvent(QMouseEvent* e) {}
-void Realtime::finish() {}
+void Realtime::finish() {
+    m_loader.cancel();
+}
@@ -11,8 +11,9 @@
 
 #include "utils/sceneparser.h"
 #include "utils/camera.h"
-#include "utils/gbuffer.h"
-#include "utils/deferredrenderer.h"
+#include "utils/scenerenderer.h"
+#include "utils/sceneloader.h"
+#include "utils/scenebvh.h"
 
 class Realtime : public QOpenGLWidget {
 public:
@@ -21,6 +22,9 @@ public:
     void sceneChanged();
     void settingsChanged();
     void saveViewportImage(const std::string& path);
+    // CSV, or JSON if path ends in .json
+    void saveGpuProfile(const std::string& path);
+    void setLoadProgressCallback(SceneLoader::ProgressCallback callback);
 
 
 protected:
@@ -37,6 +41,9 @@ protected:
 
 private:
     RenderData m_renderData;
+    SceneBvh m_sceneBvh; // rebuilt with every scene, for picking
+    int m_selectedShape = -1; // index into m_renderData.shapes, shown on the HUD
+    glm::vec3 m_selectedPoint{0.f};
     Camera m_camera;
 
     glm::vec3 m_camPos;
@@ -48,27 +55,33 @@ private:
 
     std::unordered_map<Qt::Key, bool> m_keys;
 
-    int m_timer;
+    // Frames are drawn on demand: anything that changes the image calls update().
+    // The timer runs only while frames are needed back to back (loading, depth
+    // readbacks catching up, continuous mode), so an idle window draws nothing.
+    // Key and mouse-move events draw nothing, since neither moves the camera.
+    int m_timer = 0;
     QElapsedTimer m_elapsed;
 
     double m_dpr;
 
-    struct ShapeVAO {
-        GLuint vao;
-        GLuint vbo;
-        int count;
-        glm::mat4 ctm;
-        SceneMaterial mat;
-    };
-    std::vector<ShapeVAO> m_shapes;
-
-    GBuffer gbuffer;
-    DeferredRenderer deferred;
-
-    void loadScene();
-    void generateShapeVAOs();
-    void cleanupVAOs();
-
-    void renderGeometryPass();
+    SceneRenderer m_renderer;
+    size_t m_graphLayout = 0; // the dump is printed when this changes
+
+    // Upload work handed back by m_loader is capped per frame so the window stays responsive
+    static constexpr qint64 LOAD_BUDGET_MS = 8;
+    SceneLoader m_loader;
+
+    void uploadLoadedScene();
+    // Meshes adopted from the load in flight, referenced until its scene is applied
+    std::vector<TessellationKey> m_adoptedMeshes;
+    void releaseAdoptedMeshes();
+    // Starts or stops the frame timer after each frame
+    void scheduleFrames();
+    void applyScene();
+    // Selects the shape under a window position, or clears the selection
+    void pickShape(const glm::vec2& pixel);
+
+    // Rolling per-scope GPU ms graph over the top-left corner
+    void paintProfilerHud();
 
 };
@@ -3,12 +3,26 @@
 
 #include <string>
 
+// Which renderer lights the scene
+enum class LightingPipeline {
+    Deferred,      // every pixel loops over every light
+    TiledDeferred, // every pixel loops over its 16x16 tile's culled light list
+    ForwardPlus,   // no G-buffer; every fragment loops over its cluster's light list
+};
+
 struct Settings {
     std::string sceneFilePath;
     int shapeParameter1 = 1;
     int shapeParameter2 = 1;
     float nearPlane = 1;
     float farPlane = 1;
+    LightingPipeline lightingPipeline = LightingPipeline::Deferred;
+    bool bloom = false;               // off by default: the reference images have none
+    bool profilerHud = false;
+    bool continuousRendering = false; // redraw every frame even when nothing changed
+    bool frustumCulling = true;
+    bool smallObjectCulling = false;  // with frustum culling, also skip shapes under a pixel on screen
+    bool occlusionCulling = false;    // also skip shapes hidden in a previous frame's depth
     bool perPixelFilter = false;
     bool kernelBasedFilter = false;
     bool extraCredit1 = false;
@@ -0,0 +1,51 @@
+#include "clusterlightgrid.h"
+#include <algorithm>
+#include <cmath>
+
+int ClusterLightGrid::slice(float viewDistance) const {
+    // Slice k spans near * (far/near)^(k/Z) .. near * (far/near)^((k+1)/Z)
+    float t = std::log(viewDistance / near()) / std::log(far() / near());
+    return std::clamp(int(std::floor(t * CLUSTERS_Z)), 0, CLUSTERS_Z - 1);
+}
+
+void ClusterLightGrid::build(const std::vector<SceneLightData> &lights, const glm::mat4 &view, const glm::mat4 &proj) {
+    std::vector<float> edgesX(CLUSTERS_X + 1), edgesY(CLUSTERS_Y + 1);
+    for (int i = 0; i <= CLUSTERS_X; i++) edgesX[i] = -1.f + 2.f * float(i) / CLUSTERS_X;
+    for (int j = 0; j <= CLUSTERS_Y; j++) edgesY[j] = -1.f + 2.f * float(j) / CLUSTERS_Y;
+    m_frustums.build(proj, edgesX, edgesY);
+
+    m_entries.clear();
+    for (int li = 0; li < int(lights.size()); li++) {
+        const SceneLightData &L = lights[li];
+        if (L.type == LightType::LIGHT_DIRECTIONAL) continue;
+
+        float r = lightRange(L);
+        if (r <= 0.f) continue;
+        glm::vec3 c = glm::vec3(view * glm::vec4(glm::vec3(L.pos), 1.f));
+
+        float zNear = -c.z - r, zFar = -c.z + r;
+        if (zFar < near() || zNear > far()) continue;
+
+        glm::ivec4 rect;
+        if (!m_frustums.bounds(c, r, rect)) continue;
+        int z0 = slice(std::max(zNear, near()));
+        int z1 = slice(std::min(zFar, far()));
+
+        // Slices are bounded by planes of constant z, which the depth range
+        // above already handles exactly for a sphere
+        for (int ty = rect.y; ty <= rect.w; ty++) {
+            if (!m_frustums.overlapsRow(ty, c, r)) continue;
+
+            for (int tx = rect.x; tx <= rect.z; tx++) {
+                if (!m_frustums.overlapsColumn(tx, c, r)) continue;
+
+                for (int tz = z0; tz <= z1; tz++) {
+                    m_entries.push_back({(tz * CLUSTERS_Y + ty) * CLUSTERS_X + tx, li});
+                }
+            }
+        }
+    }
+
+    // Entries were pushed per light, so each cluster's list keeps points first
+    compactLightLists(lights, m_entries, CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z, m_clusters, m_indices);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "scenedata.h"
+#include "tilelightgrid.h"
+
+// View frustum split into a CLUSTERS_X x CLUSTERS_Y x CLUSTERS_Z froxel grid,
+// each holding the point and spot lights whose influence sphere reaches it.
+// Depth slices are exponential between the near and far planes, so the forward
+// shader can find its cluster from view distance alone, without a depth prepass.
+// Directional lights are not stored. Pure CPU, like TileLightGrid.
+class ClusterLightGrid {
+public:
+    static constexpr int CLUSTERS_X = 16;
+    static constexpr int CLUSTERS_Y = 9;
+    static constexpr int CLUSTERS_Z = 24;
+
+    using Cluster = LightList;
+
+    // Index is (z * CLUSTERS_Y + y) * CLUSTERS_X + x, with y = 0 at the bottom
+    // @param lights sorted directional, point, spot (see LightBuffer)
+    void build(const std::vector<SceneLightData> &lights, const glm::mat4 &view, const glm::mat4 &proj);
+
+    // Near and far planes of the last build(), which set the slice depths
+    float near() const { return m_frustums.near; }
+    float far() const { return m_frustums.far; }
+
+    const std::vector<Cluster> &clusters() const { return m_clusters; }
+    // Indices into the light list, points before spots within each cluster
+    const std::vector<int32_t> &indices() const { return m_indices; }
+
+private:
+    std::vector<Cluster> m_clusters;
+    std::vector<int32_t> m_indices;
+
+    // Kept to avoid reallocating every frame
+    std::vector<LightListEntry> m_entries;
+    TileFrustums m_frustums;
+
+    int slice(float viewDistance) const;
+};
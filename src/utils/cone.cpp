@@ -3,11 +3,6 @@
 #include <algorithm>
 #include <cmath>
 
-static inline void pushPosNorm(std::vector<float>& dst,
-                               const glm::vec3& p, const glm::vec3& n) {
-    dst.push_back(p.x); dst.push_back(p.y); dst.push_back(p.z);
-    dst.push_back(n.x); dst.push_back(n.y); dst.push_back(n.z);
-}
 static inline glm::vec3 cyl(float r, float t, float y) {
     return {r*std::cos(t), y, r*std::sin(t)};
 }
@@ -21,16 +16,20 @@ static inline float radiusAtY(float y) {
 }
 
 void Cone::updateParams(int p1, int p2) {
-    m_vertexData.clear();
+    m_mesh.clear();
     m_param1 = std::max(1, p1);
     m_param2 = std::max(3, p2);
     setVertexData();
 }
 
 void Cone::setVertexData() {
-    m_vertexData.clear();
+    m_mesh.clear();
     const int stacks = m_param1;
     const int wedges = m_param2;
+    // One cap triangle and a two-triangle quad per stack for every wedge. Unique
+    // vertices: the cap's rim and centre, a ring per stack and one tip per wedge
+    m_mesh.reserve(size_t(wedges + 2) + size_t(stacks) * (wedges + 1) + wedges,
+                   size_t(3) * wedges + size_t(6) * wedges * stacks);
     const float dT = glm::two_pi<float>() / wedges;
     const float yBot = -0.5f, yTop = 0.5f;
     const float dy = (yTop - yBot) / stacks;
@@ -41,9 +40,9 @@ void Cone::setVertexData() {
         float t0 = k*dT, t1 = (k+1)*dT;
         glm::vec3 C(0, yBot, 0), P0 = cyl(0.5f, t0, yBot), P1 = cyl(0.5f, t1, yBot);
         // flip winding so face is visible from above
-        pushPosNorm(m_vertexData, C,  nCap);
-        pushPosNorm(m_vertexData, P0, nCap);  // ← Swapped!
-        pushPosNorm(m_vertexData, P1, nCap);
+        m_mesh.push(C,  nCap);
+        m_mesh.push(P0, nCap);  // ← Swapped!
+        m_mesh.push(P1, nCap);
     }
 
     // side surface
@@ -67,13 +66,13 @@ void Cone::setVertexData() {
             glm::vec3 nBR = (r1==0.f) ? glm::normalize(glm::vec3(tipDir.x,1,tipDir.z)) : coneNorm(BR);
 
             // tri A
-            pushPosNorm(m_vertexData, TL, nTL);
-            pushPosNorm(m_vertexData, BL, nBL);
-            pushPosNorm(m_vertexData, BR, nBR);
+            m_mesh.push(TL, nTL);
+            m_mesh.push(BL, nBL);
+            m_mesh.push(BR, nBR);
             // tri B
-            pushPosNorm(m_vertexData, TL, nTL);
-            pushPosNorm(m_vertexData, BR, nBR);
-            pushPosNorm(m_vertexData, TR, nTR);
+            m_mesh.push(TL, nTL);
+            m_mesh.push(BR, nBR);
+            m_mesh.push(TR, nTR);
         }
     }
 }
@@ -1,11 +1,16 @@
 #pragma once
 #include <vector>
 #include <glm/glm.hpp>
+#include "meshbuilder.h"
 
 class Cone {
 public:
     void updateParams(int param1, int param2); // stacks, wedges
-    std::vector<float> generateShape() const { return m_vertexData; }
+    std::vector<float> generateShape() const { return m_mesh.expand(); }
+
+    // Indexed form: unique pos + normal vertices and a triangle-list index buffer
+    const std::vector<float> &getVertexData() const { return m_mesh.vertices(); }
+    const std::vector<uint32_t> &getIndexData() const { return m_mesh.indices(); }
 
 private:
     void setVertexData();
@@ -13,7 +18,7 @@ private:
         dst.push_back(v.x); dst.push_back(v.y); dst.push_back(v.z);
     }
 
-    std::vector<float> m_vertexData;
+    MeshBuilder m_mesh;
     int   m_param1 = 1;  // stacks along height
     int   m_param2 = 3;  // wedges around
     float m_radius = 0.5f;
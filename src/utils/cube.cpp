@@ -1,19 +1,12 @@
 #include "cube.h"
 #include <glm/glm.hpp>
 
-static inline void pushPosNorm(std::vector<float>& dst,
-                               const glm::vec3& p,
-                               const glm::vec3& n) {
-    dst.push_back(p.x); dst.push_back(p.y); dst.push_back(p.z);
-    dst.push_back(n.x); dst.push_back(n.y); dst.push_back(n.z);
-}
-
 static glm::vec3 lerp(const glm::vec3 &a, const glm::vec3 &b, float t) {
     return a + t * (b - a);
 }
 
 void Cube::updateParams(int param1) {
-    m_vertexData.clear();
+    m_mesh.clear();
     m_param1 = std::max(1, param1);
     setVertexData();
 }
@@ -21,13 +14,13 @@ void Cube::updateParams(int param1) {
 void Cube::makeTile(glm::vec3 tl, glm::vec3 tr, glm::vec3 bl, glm::vec3 br) {
     glm::vec3 n = glm::normalize(glm::cross(bl - tl, br - tl));
     // Triangle 1
-    pushPosNorm(m_vertexData, tl, n);
-    pushPosNorm(m_vertexData, bl, n);
-    pushPosNorm(m_vertexData, br, n);
+    m_mesh.push(tl, n);
+    m_mesh.push(bl, n);
+    m_mesh.push(br, n);
     // Triangle 2
-    pushPosNorm(m_vertexData, tl, n);
-    pushPosNorm(m_vertexData, br, n);
-    pushPosNorm(m_vertexData, tr, n);
+    m_mesh.push(tl, n);
+    m_mesh.push(br, n);
+    m_mesh.push(tr, n);
 }
 
 void Cube::makeFace(glm::vec3 tl, glm::vec3 tr, glm::vec3 bl, glm::vec3 br) {
@@ -55,6 +48,10 @@ void Cube::makeFace(glm::vec3 tl, glm::vec3 tr, glm::vec3 bl, glm::vec3 br) {
 }
 
 void Cube::setVertexData() {
+    // Six faces of param1 x param1 tiles, two triangles each; faces share no
+    // vertices since their normals differ
+    size_t side = size_t(m_param1) + 1;
+    m_mesh.reserve(6 * side * side, size_t(36) * m_param1 * m_param1);
     const float s = 0.5f;
     // +Z
     makeFace({-s, s, s}, { s, s, s}, {-s,-s, s}, { s,-s, s});
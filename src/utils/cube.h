@@ -1,11 +1,16 @@
 #pragma once
 #include <vector>
 #include <glm/glm.hpp>
+#include "meshbuilder.h"
 
 class Cube {
 public:
     void updateParams(int param1);
-    std::vector<float> generateShape() const { return m_vertexData; }
+    std::vector<float> generateShape() const { return m_mesh.expand(); }
+
+    // Indexed form: unique pos + normal vertices and a triangle-list index buffer
+    const std::vector<float> &getVertexData() const { return m_mesh.vertices(); }
+    const std::vector<uint32_t> &getIndexData() const { return m_mesh.indices(); }
 
 private:
     void setVertexData();
@@ -15,6 +20,6 @@ private:
     void makeTile(glm::vec3 tl, glm::vec3 tr, glm::vec3 bl, glm::vec3 br);
     void makeFace(glm::vec3 tl, glm::vec3 tr, glm::vec3 bl, glm::vec3 br);
 
-    std::vector<float> m_vertexData;
+    MeshBuilder m_mesh;
     int m_param1 = 1;
 };
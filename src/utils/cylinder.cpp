@@ -3,28 +3,26 @@
 #include <algorithm>
 #include <cmath>
 
-static inline void pushPosNorm(std::vector<float>& dst,
-                               const glm::vec3& p,
-                               const glm::vec3& n) {
-    dst.push_back(p.x); dst.push_back(p.y); dst.push_back(p.z);
-    dst.push_back(n.x); dst.push_back(n.y); dst.push_back(n.z);
-}
 static inline glm::vec3 cyl(float r, float th, float y) {
     return {r*std::cos(th), y, r*std::sin(th)};
 }
 
 void Cylinder::updateParams(int p1, int p2) {
-    m_vertexData.clear();
+    m_mesh.clear();
     m_param1 = std::max(1, p1);
     m_param2 = std::max(3, p2);
     setVertexData();
 }
 
 void Cylinder::setVertexData() {
-    m_vertexData.clear();
+    m_mesh.clear();
 
     const int stacks = m_param1;
     const int wedges = m_param2;
+    // Two cap triangles and a two-triangle quad per stack for every wedge. Unique
+    // vertices: each cap's rim and centre and stacks + 1 side rings
+    m_mesh.reserve(size_t(2) * (wedges + 2) + size_t(stacks + 1) * (wedges + 1),
+                   size_t(6) * wedges + size_t(6) * wedges * stacks);
     const float r    = m_radius;
     const float yTop =  0.5f, yBot = -0.5f;
     const float dT   = glm::two_pi<float>() / wedges;
@@ -36,9 +34,9 @@ void Cylinder::setVertexData() {
         glm::vec3 C(0,yBot,0), P0 = cyl(r,t0,yBot), P1 = cyl(r,t1,yBot);
         glm::vec3 n(0,-1,0);
         // wind so face is visible from above
-        pushPosNorm(m_vertexData, C,  n);
-        pushPosNorm(m_vertexData, P0, n);  // ← Swapped!
-        pushPosNorm(m_vertexData, P1, n);
+        m_mesh.push(C,  n);
+        m_mesh.push(P0, n);  // ← Swapped!
+        m_mesh.push(P1, n);
     }
 
     // top cap (normal up)
@@ -46,9 +44,9 @@ void Cylinder::setVertexData() {
         float t0 = k*dT, t1 = (k+1)*dT;
         glm::vec3 C(0,yTop,0), P0 = cyl(r,t0,yTop), P1 = cyl(r,t1,yTop);
         glm::vec3 n(0,1,0);
-        pushPosNorm(m_vertexData, C,  n);
-        pushPosNorm(m_vertexData, P1, n);  // ← P1 first
-        pushPosNorm(m_vertexData, P0, n);
+        m_mesh.push(C,  n);
+        m_mesh.push(P1, n);  // ← P1 first
+        m_mesh.push(P0, n);
     }
 
     // side surface
@@ -67,13 +65,13 @@ void Cylinder::setVertexData() {
             glm::vec3 BR = cyl(r,t1,y1);
 
             // tri A
-            pushPosNorm(m_vertexData, TL, n0);
-            pushPosNorm(m_vertexData, BL, n0);
-            pushPosNorm(m_vertexData, BR, n1);
+            m_mesh.push(TL, n0);
+            m_mesh.push(BL, n0);
+            m_mesh.push(BR, n1);
             // tri B
-            pushPosNorm(m_vertexData, TL, n0);
-            pushPosNorm(m_vertexData, BR, n1);
-            pushPosNorm(m_vertexData, TR, n1);
+            m_mesh.push(TL, n0);
+            m_mesh.push(BR, n1);
+            m_mesh.push(TR, n1);
         }
     }
 }
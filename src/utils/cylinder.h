@@ -1,12 +1,17 @@
 #pragma once
 #include <vector>
 #include <glm/glm.hpp>
+#include "meshbuilder.h"
 
 class Cylinder {
 public:
     // param1 = stacks (height), param2 = wedges (around)
     void updateParams(int param1, int param2);
-    std::vector<float> generateShape() const { return m_vertexData; }
+    std::vector<float> generateShape() const { return m_mesh.expand(); }
+
+    // Indexed form: unique pos + normal vertices and a triangle-list index buffer
+    const std::vector<float> &getVertexData() const { return m_mesh.vertices(); }
+    const std::vector<uint32_t> &getIndexData() const { return m_mesh.indices(); }
 
 private:
     void setVertexData();
@@ -14,7 +19,7 @@ private:
         dst.push_back(v.x); dst.push_back(v.y); dst.push_back(v.z);
     }
 
-    std::vector<float> m_vertexData;
+    MeshBuilder m_mesh;
     int   m_param1 = 1;
     int   m_param2 = 16;
     float m_radius = 0.5f;
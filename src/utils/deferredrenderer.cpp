@@ -1,16 +1,127 @@
 #include "deferredrenderer.h"
+#include "glstate.h"
+#include "postprocesspass.h"
 #include <GL/glew.h>
+#include <cstring>
 
 void DeferredRenderer::init() {
+    shaderGeometry = new ShaderProgram();
+    shaderGeometry->attachShader(":/resources/shaders/gbuffer.vert", GL_VERTEX_SHADER);
+    shaderGeometry->attachShader(":/resources/shaders/gbuffer.frag", GL_FRAGMENT_SHADER);
+    shaderGeometry->link();
+
     shaderDeferred = new ShaderProgram();
     shaderDeferred->attachShader(":/resources/shaders/fullscreen_quad.vert", GL_VERTEX_SHADER);
     shaderDeferred->attachShader(":/resources/shaders/deferredLighting.frag", GL_FRAGMENT_SHADER);
     shaderDeferred->link();
 
+    shaderTiled = new ShaderProgram();
+    shaderTiled->attachShader(":/resources/shaders/fullscreen_quad.vert", GL_VERTEX_SHADER);
+    shaderTiled->attachShader(":/resources/shaders/deferredLightingTiled.frag", GL_FRAGMENT_SHADER);
+    shaderTiled->link();
+
+    shaderDepthBounds = new ShaderProgram();
+    shaderDepthBounds->attachShader(":/resources/shaders/fullscreen_quad.vert", GL_VERTEX_SHADER);
+    shaderDepthBounds->attachShader(":/resources/shaders/tileDepthBounds.frag", GL_FRAGMENT_SHADER);
+    shaderDepthBounds->link();
+
+    // Sampler units and uniform blocks never change, so they are set once here
+    FrameUniforms::attach(shaderGeometry->id);
+    shaderGeometry->use();
+    shaderGeometry->setUniform1i("materials", 0);
+
+    FrameUniforms::attach(shaderDeferred->id);
+    shaderDeferred->use();
+    shaderDeferred->setUniform1i("gDepth", 0);
+    shaderDeferred->setUniform1i("gNormal", 1);
+    shaderDeferred->setUniform1i("gAlbedo", 2);
+    shaderDeferred->setUniform1i("gEmissive", 3);
+    shaderDeferred->setUniform1i("lightData", 4);
+    shaderDeferred->setUniform1f("bloomThreshold", PostProcessPass::BLOOM_THRESHOLD);
+
+    FrameUniforms::attach(shaderTiled->id);
+    shaderTiled->use();
+    shaderTiled->setUniform1i("gDepth", 0);
+    shaderTiled->setUniform1i("gNormal", 1);
+    shaderTiled->setUniform1i("gAlbedo", 2);
+    shaderTiled->setUniform1i("gEmissive", 3);
+    shaderTiled->setUniform1i("lightData", 4);
+    shaderTiled->setUniform1i("tiles", 5);
+    shaderTiled->setUniform1i("tileIndices", 6);
+    shaderTiled->setUniform1i("tileSize", TileLightGrid::TILE_SIZE);
+    shaderTiled->setUniform1f("bloomThreshold", PostProcessPass::BLOOM_THRESHOLD);
+
+    FrameUniforms::attach(shaderDepthBounds->id);
+    shaderDepthBounds->use();
+    shaderDepthBounds->setUniform1i("gDepth", 0);
+    shaderDepthBounds->setUniform1i("tileSize", TileLightGrid::TILE_SIZE);
+    GLState::current().useProgram(0);
+
+    m_kd = shaderGeometry->uniform("k_d");
+    m_numDirectional = shaderDeferred->uniform("numDirectional");
+    m_numPoint = shaderDeferred->uniform("numPoint");
+    m_numSpot = shaderDeferred->uniform("numSpot");
+    m_hasEmissive = shaderDeferred->uniform("hasEmissive");
+    m_tiledNumDirectional = shaderTiled->uniform("numDirectional");
+    m_tiledHasEmissive = shaderTiled->uniform("hasEmissive");
+    m_tilesX = shaderTiled->uniform("tilesX");
+
+    m_lights.init();
+    m_lights.upload({});
+
+    for (BoundsReadback& readback : m_readbacks) glGenBuffers(1, &readback.pbo);
+    glGenBuffers(1, &m_tilesTBO);
+    glGenTextures(1, &m_tilesTex);
+    glGenBuffers(1, &m_indicesTBO);
+    glGenTextures(1, &m_indicesTex);
+
     initQuad();
 }
 
+void DeferredRenderer::resize(int w, int h) {
+    GLState& gl = GLState::current();
+    m_width = w;
+    m_height = h;
+    m_grid.resize(w, h);
+    size_t tiles = size_t(m_grid.tilesX) * m_grid.tilesY;
+    invalidateDepthBounds();
+    m_depthBounds.resize(tiles);
+    m_unbounded.assign(tiles, glm::vec2(0.f, 1e30f));
+
+    glDeleteFramebuffers(1, &m_boundsFBO);
+    glDeleteTextures(1, &m_boundsTex);
+
+    glGenFramebuffers(1, &m_boundsFBO);
+    gl.bindFramebuffer(m_boundsFBO);
+
+    glGenTextures(1, &m_boundsTex);
+    gl.bindTexture(GL_TEXTURE_2D, m_boundsTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, m_grid.tilesX, m_grid.tilesY, 0, GL_RG, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_boundsTex, 0);
+
+    gl.bindFramebuffer(0);
+
+    for (BoundsReadback& readback : m_readbacks) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, tiles * sizeof(glm::vec2), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void DeferredRenderer::invalidateDepthBounds() {
+    m_boundsGeneration++;
+    m_haveBounds = false;
+}
+
+void DeferredRenderer::releaseReadback(BoundsReadback& readback) {
+    if (readback.fence) glDeleteSync(readback.fence);
+    readback.fence = nullptr;
+}
+
 void DeferredRenderer::initQuad() {
+    GLState& gl = GLState::current();
     float verts[] = {
         -1.f, -1.f, 0.f, 0.f, 0.f,
         1.f, -1.f, 0.f, 1.f, 0.f,
@@ -21,7 +132,7 @@ void DeferredRenderer::initQuad() {
     glGenVertexArrays(1, &quadVAO);
     glGenBuffers(1, &quadVBO);
 
-    glBindVertexArray(quadVAO);
+    gl.bindVertexArray(quadVAO);
     glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
 
@@ -31,55 +142,152 @@ void DeferredRenderer::initQuad() {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(3*sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    glBindVertexArray(0);
+    gl.bindVertexArray(0);
 }
 
 void DeferredRenderer::drawQuad() {
-    glBindVertexArray(quadVAO);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
+    // Left bound: the next quad needs no rebind, and GLState unbinds it at frame end
+    GLState& gl = GLState::current();
+    gl.bindVertexArray(quadVAO);
+    gl.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+void DeferredRenderer::setLights(const std::vector<SceneLightData>& lights) {
+    m_lights.upload(lights);
+}
+
+void DeferredRenderer::setGlobal(const SceneGlobalData& global) {
+    shaderGeometry->use();
+    shaderGeometry->set(m_kd, global.kd);
 }
 
-void DeferredRenderer::render(GBuffer* gbuf, const std::vector<SceneLightData>& lights, const glm::vec3& camPos) {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+void DeferredRenderer::bindGBuffer(GBuffer* gbuf) {
+    GLState& gl = GLState::current();
+    gl.activeTexture(GL_TEXTURE0);
+    gl.bindTexture(GL_TEXTURE_2D, gbuf->texDepth);
+
+    gl.activeTexture(GL_TEXTURE1);
+    gl.bindTexture(GL_TEXTURE_2D, gbuf->texNormal);
+
+    gl.activeTexture(GL_TEXTURE2);
+    gl.bindTexture(GL_TEXTURE_2D, gbuf->texAlbedo);
+
+    gl.activeTexture(GL_TEXTURE3);
+    gl.bindTexture(GL_TEXTURE_2D, gbuf->texEmissive);
+
+    m_lights.bind(GL_TEXTURE4);
+}
+
+void DeferredRenderer::render(GBuffer* gbuf, GLuint target) {
+    GLState::current().bindFramebuffer(target);
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
 
     shaderDeferred->use();
-    shaderDeferred->setUniform1i("gPosition", 0);
-    shaderDeferred->setUniform1i("gNormal", 1);
-    shaderDeferred->setUniform1i("gAlbedo", 2);
-    shaderDeferred->setUniform1i("gEmissive", 3);
 
-    shaderDeferred->setUniform3f("camPos", camPos);
+    shaderDeferred->set(m_numDirectional, m_lights.numDirectional);
+    shaderDeferred->set(m_numPoint, m_lights.numPoint);
+    shaderDeferred->set(m_numSpot, m_lights.numSpot);
+    shaderDeferred->set(m_hasEmissive, int(gbuf->hasEmissive()));
+
+    bindGBuffer(gbuf);
 
-    int count = lights.size() > 8 ? 8 : lights.size();
-    shaderDeferred->setUniform1i("numLights", count);
+    drawQuad();
+}
 
-    for (int i = 0; i < count; i++) {
-        const SceneLightData& L = lights[i];
-        glm::vec3 col = glm::vec3(L.color);
+void DeferredRenderer::computeDepthBounds(GBuffer* gbuf, GLuint target, const glm::mat4& view, const glm::mat4& proj) {
+    // Still not back after BOUNDS_IN_FLIGHT frames; drop it rather than wait
+    BoundsReadback& readback = m_readbacks[m_nextReadback];
+    releaseReadback(readback);
+    m_nextReadback = (m_nextReadback + 1) % BOUNDS_IN_FLIGHT;
+
+    GLState& gl = GLState::current();
+    gl.bindFramebuffer(m_boundsFBO);
+    glViewport(0, 0, m_grid.tilesX, m_grid.tilesY);
+
+    shaderDepthBounds->use();
+    gl.activeTexture(GL_TEXTURE0);
+    gl.bindTexture(GL_TEXTURE_2D, gbuf->texDepth);
+    drawQuad();
 
-        shaderDeferred->setUniform3f("lights["+std::to_string(i)+"].pos", glm::vec3(L.pos));
-        shaderDeferred->setUniform3f("lights["+std::to_string(i)+"].color", col);
-        shaderDeferred->setUniform3f("lights["+std::to_string(i)+"].dir", glm::vec3(L.dir));
-        shaderDeferred->setUniform1f("lights["+std::to_string(i)+"].angle", L.angle);
-        shaderDeferred->setUniform1f("lights["+std::to_string(i)+"].penumbra", L.penumbra);
-        shaderDeferred->setUniform3f("lights["+std::to_string(i)+"].atten", glm::vec3(L.function));
-        shaderDeferred->setUniform1i("lights["+std::to_string(i)+"].type", (int)L.type);
+    // Into the pixel buffer; the copy completes asynchronously
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    glReadPixels(0, 0, m_grid.tilesX, m_grid.tilesY, GL_RG, GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readback.view = view;
+    readback.proj = proj;
+    readback.generation = m_boundsGeneration;
+
+    gl.bindFramebuffer(target);
+    glViewport(0, 0, m_width, m_height);
+}
+
+void DeferredRenderer::collectDepthBounds() {
+    // Oldest first, stopping at the first readback still in flight
+    BoundsReadback* newest = nullptr;
+    for (int i = 0; i < BOUNDS_IN_FLIGHT; i++) {
+        BoundsReadback& readback = m_readbacks[(m_nextReadback + i) % BOUNDS_IN_FLIGHT];
+        if (!readback.fence) continue;
+        GLenum status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        releaseReadback(readback);
+        if (readback.generation == m_boundsGeneration) newest = &readback;
     }
+    if (!newest) return;
+
+    size_t bytes = m_depthBounds.size() * sizeof(glm::vec2);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, newest->pbo);
+    const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+    if (data) {
+        std::memcpy(m_depthBounds.data(), data, bytes);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        m_boundsView = newest->view;
+        m_boundsProj = newest->proj;
+        m_haveBounds = true;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void DeferredRenderer::uploadTiles() {
+    GLState& gl = GLState::current();
+    const auto& tiles = m_grid.tiles();
+    const auto& indices = m_grid.indices();
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, gbuf->texPosition);
+    // Orphaned every frame; an empty texture buffer is still a valid binding
+    glBindBuffer(GL_TEXTURE_BUFFER, m_tilesTBO);
+    gl.bufferData(GL_TEXTURE_BUFFER, tiles.size() * sizeof(TileLightGrid::Tile), tiles.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_indicesTBO);
+    gl.bufferData(GL_TEXTURE_BUFFER, indices.size() * sizeof(int32_t), indices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, gbuf->texNormal);
+    gl.activeTexture(GL_TEXTURE5);
+    gl.bindTexture(GL_TEXTURE_BUFFER, m_tilesTex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32I, m_tilesTBO);
 
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, gbuf->texAlbedo);
+    gl.activeTexture(GL_TEXTURE6);
+    gl.bindTexture(GL_TEXTURE_BUFFER, m_indicesTex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32I, m_indicesTBO);
+}
+
+void DeferredRenderer::renderTiled(GBuffer* gbuf, GLuint target, const glm::mat4& view, const glm::mat4& proj) {
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
 
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, gbuf->texEmissive);
+    // Bounds from another camera could cull lights off surfaces now in view
+    collectDepthBounds();
+    bool current = m_haveBounds && m_boundsView == view && m_boundsProj == proj;
+    m_boundsStale = !current;
+    m_grid.build(m_lights.sorted(), view, proj, current ? m_depthBounds : m_unbounded);
+    computeDepthBounds(gbuf, target, view, proj);
+
+    shaderTiled->use();
+    shaderTiled->set(m_tiledNumDirectional, m_lights.numDirectional);
+    shaderTiled->set(m_tilesX, m_grid.tilesX);
+    shaderTiled->set(m_tiledHasEmissive, int(gbuf->hasEmissive()));
+
+    bindGBuffer(gbuf);
+    uploadTiles();
 
     drawQuad();
 }
@@ -87,6 +295,21 @@ void DeferredRenderer::render(GBuffer* gbuf, const std::vector<SceneLightData>&
 void DeferredRenderer::destroy() {
     glDeleteVertexArrays(1, &quadVAO);
     glDeleteBuffers(1, &quadVBO);
+    m_lights.destroy();
+    for (BoundsReadback& readback : m_readbacks) {
+        releaseReadback(readback);
+        glDeleteBuffers(1, &readback.pbo);
+        readback.pbo = 0;
+    }
+    glDeleteFramebuffers(1, &m_boundsFBO);
+    glDeleteTextures(1, &m_boundsTex);
+    glDeleteTextures(1, &m_tilesTex);
+    glDeleteBuffers(1, &m_tilesTBO);
+    glDeleteTextures(1, &m_indicesTex);
+    glDeleteBuffers(1, &m_indicesTBO);
+    delete shaderGeometry;
     delete shaderDeferred;
+    delete shaderTiled;
+    delete shaderDepthBounds;
 }
 
@@ -9,16 +9,83 @@
 #include "gbuffer.h"
 #include "shaderprogram.h"
 #include "sceneparser.h"
+#include "frameuniforms.h"
+#include "lightbuffer.h"
+#include "tilelightgrid.h"
 
 class DeferredRenderer {
 public:
+    ShaderProgram* shaderGeometry;
     ShaderProgram* shaderDeferred;
+    ShaderProgram* shaderTiled;
+    ShaderProgram* shaderDepthBounds;
     GLuint quadVAO, quadVBO;
 
     void init();
-    void render(GBuffer* gbuf, const std::vector<SceneLightData>& lights, const glm::vec3& camPos);
+    // Sizes the per-tile targets; call with the G-buffer's pixel size
+    void resize(int w, int h);
+    // Uploads the light buffer; call only when the scene's lights change
+    void setLights(const std::vector<SceneLightData>& lights);
+    // Only the diffuse coefficient applies; there is no ambient or specular term
+    void setGlobal(const SceneGlobalData& global);
+    // Camera state comes from the FrameData block (see FrameUniforms).
+    // target receives the colour and, as a second draw buffer, the bloom bright-pass.
+    void render(GBuffer* gbuf, GLuint target);
+    // Same output as render(), but each pixel only shades the point and spot
+    // lights of its TileLightGrid tile. view/proj must match the FrameData block.
+    // Tiles are depth-culled with bounds read back from an earlier frame rendered
+    // with the same view and projection; after camera motion, until such a
+    // readback arrives, lights are culled by the tile side planes only.
+    void renderTiled(GBuffer* gbuf, GLuint target, const glm::mat4& view, const glm::mat4& proj);
+    // Drops depth bounds read back so far; call when the geometry changes
+    void invalidateDepthBounds();
+    // The last renderTiled() had no bounds for its camera; a later frame with
+    // the same camera will, once the readback it queued is back
+    bool depthBoundsStale() const { return m_boundsStale; }
     void destroy();
 private:
+    LightBuffer m_lights;
+
+    // Resolved once in init() so render() does no string lookups
+    ShaderProgram::Uniform m_kd, m_numDirectional, m_numPoint, m_numSpot, m_hasEmissive;
+    ShaderProgram::Uniform m_tiledNumDirectional, m_tilesX, m_tiledHasEmissive;
+
+    int m_width = 0, m_height = 0;
+
+    // Tiled path: per-tile depth bounds are reduced on the GPU into a
+    // tilesX x tilesY RG32F target and read back through a ring of pixel
+    // buffers, polled with fences (as HiZBuffer does) so the CPU never waits on
+    // the frame it is building; later frames use them to cull lights on the CPU
+    static constexpr int BOUNDS_IN_FLIGHT = 3;
+    struct BoundsReadback {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        glm::mat4 view, proj;
+        uint64_t generation = 0;
+    };
+
+    TileLightGrid m_grid;
+    GLuint m_boundsFBO = 0, m_boundsTex = 0;
+    BoundsReadback m_readbacks[BOUNDS_IN_FLIGHT];
+    int m_nextReadback = 0;
+    uint64_t m_boundsGeneration = 0; // bumped by invalidateDepthBounds()
+    // Newest finished readback and the camera it was rendered with
+    std::vector<glm::vec2> m_depthBounds;
+    glm::mat4 m_boundsView{1.f}, m_boundsProj{1.f};
+    bool m_haveBounds = false;
+    bool m_boundsStale = false;
+    std::vector<glm::vec2> m_unbounded; // every tile spanning all depths
+    GLuint m_tilesTBO = 0, m_tilesTex = 0;
+    GLuint m_indicesTBO = 0, m_indicesTex = 0;
+
+    void bindGBuffer(GBuffer* gbuf);
+    // Reduces this frame's depth and queues its readback
+    void computeDepthBounds(GBuffer* gbuf, GLuint target, const glm::mat4& view, const glm::mat4& proj);
+    // Takes the newest finished readback, if any, without waiting
+    void collectDepthBounds();
+    void releaseReadback(BoundsReadback& readback);
+    void uploadTiles();
+
     void initQuad();
     void drawQuad();
 };
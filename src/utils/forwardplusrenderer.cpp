@@ -0,0 +1,100 @@
+#include "forwardplusrenderer.h"
+#include "glstate.h"
+#include "postprocesspass.h"
+#include <GL/glew.h>
+#include <cmath>
+
+void ForwardPlusRenderer::init() {
+    // gbuffer.vert already emits world-space position, normal and material index
+    shaderForward = new ShaderProgram();
+    shaderForward->attachShader(":/resources/shaders/gbuffer.vert", GL_VERTEX_SHADER);
+    shaderForward->attachShader(":/resources/shaders/forwardPlus.frag", GL_FRAGMENT_SHADER);
+    shaderForward->link();
+
+    FrameUniforms::attach(shaderForward->id);
+    shaderForward->use();
+    shaderForward->setUniform1i("materials", 0);
+    shaderForward->setUniform1i("lightData", 1);
+    shaderForward->setUniform1i("clusters", 2);
+    shaderForward->setUniform1i("clusterIndices", 3);
+    shaderForward->setUniform1f("bloomThreshold", PostProcessPass::BLOOM_THRESHOLD);
+    shaderForward->set(shaderForward->uniform("clusterDims"),
+                       glm::ivec3(ClusterLightGrid::CLUSTERS_X, ClusterLightGrid::CLUSTERS_Y, ClusterLightGrid::CLUSTERS_Z));
+    GLState::current().useProgram(0);
+
+    m_ka = shaderForward->uniform("k_a");
+    m_kd = shaderForward->uniform("k_d");
+    m_ks = shaderForward->uniform("k_s");
+    m_numDirectional = shaderForward->uniform("numDirectional");
+    m_clusterScale = shaderForward->uniform("clusterScale");
+    m_sliceParams = shaderForward->uniform("sliceParams");
+
+    m_lights.init();
+    m_lights.upload({});
+
+    glGenBuffers(1, &m_clustersTBO);
+    glGenTextures(1, &m_clustersTex);
+    glGenBuffers(1, &m_indicesTBO);
+    glGenTextures(1, &m_indicesTex);
+}
+
+void ForwardPlusRenderer::resize(int w, int h) {
+    m_width = w;
+    m_height = h;
+}
+
+void ForwardPlusRenderer::setLights(const std::vector<SceneLightData>& lights) {
+    m_lights.upload(lights);
+}
+
+void ForwardPlusRenderer::setGlobal(const SceneGlobalData& global) {
+    shaderForward->use();
+    shaderForward->set(m_ka, global.ka);
+    shaderForward->set(m_kd, global.kd);
+    shaderForward->set(m_ks, global.ks);
+}
+
+void ForwardPlusRenderer::uploadClusters() {
+    GLState& gl = GLState::current();
+    const auto& clusters = m_grid.clusters();
+    const auto& indices = m_grid.indices();
+
+    // Orphaned every frame; an empty texture buffer is still a valid binding
+    glBindBuffer(GL_TEXTURE_BUFFER, m_clustersTBO);
+    gl.bufferData(GL_TEXTURE_BUFFER, clusters.size() * sizeof(ClusterLightGrid::Cluster), clusters.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, m_indicesTBO);
+    gl.bufferData(GL_TEXTURE_BUFFER, indices.size() * sizeof(int32_t), indices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    gl.activeTexture(GL_TEXTURE2);
+    gl.bindTexture(GL_TEXTURE_BUFFER, m_clustersTex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32I, m_clustersTBO);
+
+    gl.activeTexture(GL_TEXTURE3);
+    gl.bindTexture(GL_TEXTURE_BUFFER, m_indicesTex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32I, m_indicesTBO);
+}
+
+void ForwardPlusRenderer::begin(const glm::mat4& view, const glm::mat4& proj, MaterialTable& materials) {
+    m_grid.build(m_lights.sorted(), view, proj);
+
+    shaderForward->use();
+    shaderForward->set(m_numDirectional, m_lights.numDirectional);
+    shaderForward->set(m_clusterScale, glm::vec2(float(ClusterLightGrid::CLUSTERS_X) / m_width,
+                                                 float(ClusterLightGrid::CLUSTERS_Y) / m_height));
+    shaderForward->set(m_sliceParams, glm::vec2(m_grid.near(),
+                                                ClusterLightGrid::CLUSTERS_Z / std::log(m_grid.far() / m_grid.near())));
+
+    materials.bind(GL_TEXTURE0);
+    m_lights.bind(GL_TEXTURE1);
+    uploadClusters();
+}
+
+void ForwardPlusRenderer::destroy() {
+    m_lights.destroy();
+    glDeleteTextures(1, &m_clustersTex);
+    glDeleteBuffers(1, &m_clustersTBO);
+    glDeleteTextures(1, &m_indicesTex);
+    glDeleteBuffers(1, &m_indicesTBO);
+    delete shaderForward;
+}
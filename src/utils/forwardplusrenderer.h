@@ -0,0 +1,49 @@
+#pragma once
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "shaderprogram.h"
+#include "sceneparser.h"
+#include "frameuniforms.h"
+#include "lightbuffer.h"
+#include "materialtable.h"
+#include "clusterlightgrid.h"
+
+// Clustered forward+ alternative to GBuffer + DeferredRenderer: shapes are
+// shaded directly with the Phong model of default.frag, each fragment looping
+// only over the lights of its ClusterLightGrid froxel. Writes no G-buffer.
+class ForwardPlusRenderer {
+public:
+    ShaderProgram* shaderForward;
+
+    void init();
+    // Viewport size in pixels, used to map fragments to clusters
+    void resize(int w, int h);
+    // Call only when the scene changes, like DeferredRenderer::setLights
+    void setLights(const std::vector<SceneLightData>& lights);
+    void setGlobal(const SceneGlobalData& global);
+
+    // Builds this frame's cluster lists and binds the forward shader with its
+    // buffers; the caller then draws the instanced batches into the bound target.
+    // view/proj must match the FrameData block.
+    void begin(const glm::mat4& view, const glm::mat4& proj, MaterialTable& materials);
+    void destroy();
+
+private:
+    LightBuffer m_lights;
+    ClusterLightGrid m_grid;
+
+    GLuint m_clustersTBO = 0, m_clustersTex = 0;
+    GLuint m_indicesTBO = 0, m_indicesTex = 0;
+
+    int m_width = 1, m_height = 1;
+
+    ShaderProgram::Uniform m_ka, m_kd, m_ks;
+    ShaderProgram::Uniform m_numDirectional, m_clusterScale, m_sliceParams;
+
+    void uploadClusters();
+};
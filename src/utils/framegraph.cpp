@@ -0,0 +1,180 @@
+#include "framegraph.h"
+#include <algorithm>
+#include <sstream>
+
+static size_t textureBytes(const FrameGraph::TextureDesc& desc) {
+    return RenderTargetPool::textureBytes(desc.format, desc.width, desc.height);
+}
+
+FrameGraph::Resource FrameGraph::PassBuilder::create(const std::string& name, const TextureDesc& desc) {
+    Resource r = Resource(m_graph.m_resources.size());
+    m_graph.m_resources.push_back({name, desc, false, 0});
+    m_graph.m_passes[m_pass].creates.push_back(r);
+    write(r);
+    return r;
+}
+
+void FrameGraph::PassBuilder::read(Resource r) {
+    m_graph.m_passes[m_pass].reads.push_back(r);
+}
+
+void FrameGraph::PassBuilder::write(Resource r) {
+    m_graph.m_passes[m_pass].writes.push_back(r);
+    m_graph.m_resources[r].producer = m_pass;
+}
+
+void FrameGraph::PassBuilder::sideEffect() {
+    m_graph.m_passes[m_pass].sideEffect = true;
+}
+
+void FrameGraph::reset() {
+    m_resources.clear();
+    m_passes.clear();
+}
+
+FrameGraph::Resource FrameGraph::import(const std::string& name, GLuint texture) {
+    Resource r = Resource(m_resources.size());
+    m_resources.push_back({name, TextureDesc{GL_NONE, 0, 0}, true, texture});
+    return r;
+}
+
+void FrameGraph::addPass(const std::string& name, const Setup& setup, Execute execute) {
+    int index = int(m_passes.size());
+    m_passes.push_back({name, std::move(execute)});
+    PassBuilder builder(*this, index);
+    setup(builder);
+}
+
+void FrameGraph::cull() {
+    for (ResourceNode& res : m_resources) res.readers = 0;
+    for (PassNode& pass : m_passes) {
+        pass.refCount = 0;
+        pass.culled = false;
+        for (Resource r : pass.reads) m_resources[r].readers++;
+        for (Resource r : pass.writes) {
+            // Imported targets are read outside the graph
+            if (m_resources[r].imported) pass.sideEffect = true;
+        }
+    }
+
+    // A pass is referenced once per written resource that something reads
+    for (PassNode& pass : m_passes) {
+        for (Resource r : pass.writes) {
+            if (m_resources[r].readers > 0) pass.refCount++;
+        }
+    }
+
+    // Flood from unreferenced passes back through the resources they read
+    std::vector<int> unreferenced;
+    for (int i = 0; i < int(m_passes.size()); i++) {
+        if (m_passes[i].refCount == 0 && !m_passes[i].sideEffect) unreferenced.push_back(i);
+    }
+    while (!unreferenced.empty()) {
+        PassNode& pass = m_passes[unreferenced.back()];
+        unreferenced.pop_back();
+        pass.culled = true;
+
+        for (Resource r : pass.reads) {
+            if (--m_resources[r].readers > 0) continue;
+            int producer = m_resources[r].producer;
+            if (producer < 0) continue;
+            PassNode& source = m_passes[producer];
+            if (--source.refCount == 0 && !source.sideEffect && !source.culled) unreferenced.push_back(producer);
+        }
+    }
+}
+
+void FrameGraph::computeLifetimes() {
+    for (ResourceNode& res : m_resources) res.first = res.last = -1;
+    for (int i = 0; i < int(m_passes.size()); i++) {
+        const PassNode& pass = m_passes[i];
+        if (pass.culled) continue;
+        auto touch = [&](Resource r) {
+            ResourceNode& res = m_resources[r];
+            if (res.first < 0) res.first = i;
+            res.last = i;
+        };
+        for (Resource r : pass.reads) touch(r);
+        for (Resource r : pass.writes) touch(r);
+    }
+}
+
+void FrameGraph::execute(RenderTargetPool& pool, GpuProfiler* profiler) {
+    cull();
+    computeLifetimes();
+
+    std::vector<size_t> liveBytes(m_passes.size(), 0);
+    size_t live = 0;
+    for (int i = 0; i < int(m_passes.size()); i++) {
+        PassNode& pass = m_passes[i];
+        if (pass.culled) continue;
+
+        for (Resource r : pass.creates) {
+            ResourceNode& res = m_resources[r];
+            if (res.first != i) continue;
+            res.texture = pool.acquireTexture(res.desc.format, res.desc.width, res.desc.height, res.desc.filter);
+            live += textureBytes(res.desc);
+        }
+        liveBytes[i] = live;
+
+        {
+            GpuProfiler::Scope scope(profiler, pass.name);
+            pass.execute();
+        }
+
+        for (ResourceNode& res : m_resources) {
+            if (res.imported || res.last != i) continue;
+            pool.releaseTexture(res.texture);
+            live -= textureBytes(res.desc);
+        }
+    }
+
+    writeDump(liveBytes, pool);
+}
+
+void FrameGraph::writeDump(const std::vector<size_t>& liveBytes, const RenderTargetPool& pool) {
+    std::ostringstream out;
+    size_t hash = m_passes.size();
+    auto mix = [&](size_t v) { hash ^= v + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2); };
+
+    m_peakBytes = 0;
+    out << "FrameGraph: " << m_passes.size() << " passes, " << m_resources.size() << " resources\n";
+    for (int i = 0; i < int(m_passes.size()); i++) {
+        const PassNode& pass = m_passes[i];
+        mix(std::hash<std::string>()(pass.name));
+        mix(pass.culled);
+        m_peakBytes = std::max(m_peakBytes, liveBytes[i]);
+
+        out << "  pass " << i << " " << pass.name;
+        if (pass.culled) {
+            out << " (culled)\n";
+            continue;
+        }
+        out << "  live " << liveBytes[i] / 1024 << " KiB\n";
+        for (Resource r : pass.reads) out << "    read  " << m_resources[r].name << "\n";
+        for (Resource r : pass.writes) out << "    write " << m_resources[r].name << "\n";
+    }
+
+    for (const ResourceNode& res : m_resources) {
+        if (res.imported) continue;
+        mix(res.desc.format);
+        mix(size_t(res.desc.width) << 32 | size_t(res.desc.height));
+
+        out << "  resource " << res.name << " " << res.desc.width << "x" << res.desc.height
+            << " fmt 0x" << std::hex << res.desc.format << std::dec;
+        if (res.first < 0) {
+            out << " unused\n";
+        } else {
+            // Transients sharing a texture name were aliased by the pool
+            out << " passes " << res.first << "-" << res.last << " tex " << res.texture
+                << " " << textureBytes(res.desc) / 1024 << " KiB\n";
+        }
+    }
+    out << "  peak transient memory " << m_peakBytes / 1024 << " KiB\n";
+    // Pooled textures outlive the frame, so the pool can hold more than the peak
+    out << "  render target pool " << pool.bytesAllocated() / 1024 << " KiB allocated, "
+        << pool.bytesInUse() / 1024 << " KiB in use after the frame\n";
+
+    m_dump = out.str();
+    m_layoutHash = hash;
+}
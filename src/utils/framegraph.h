@@ -0,0 +1,115 @@
+#pragma once
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gpuprofiler.h"
+#include "rendertargetpool.h"
+
+// Per-frame graph of render passes. Each frame, passes are added in execution
+// order and declare which textures they create, read and write; execute() then
+//   - culls passes whose outputs nothing reads (imported targets count as read),
+//   - acquires each transient texture from the RenderTargetPool right before its
+//     first use and releases it right after its last, so later transients with
+//     the same format and size alias its memory,
+//   - records a pass/resource dump with the frame's peak transient memory and
+//     the GPU memory the pool holds,
+//   - times each surviving pass under its name when given a GpuProfiler.
+class FrameGraph {
+public:
+    using Resource = int;
+
+    struct TextureDesc {
+        GLenum format;
+        int width;
+        int height;
+        GLenum filter = GL_NEAREST;
+    };
+
+    class PassBuilder {
+    public:
+        // New transient texture, allocated only if this pass survives culling
+        Resource create(const std::string& name, const TextureDesc& desc);
+        void read(Resource r);
+        void write(Resource r);
+        // Keeps the pass even if nothing reads its outputs
+        void sideEffect();
+
+    private:
+        friend class FrameGraph;
+        PassBuilder(FrameGraph& graph, int pass) : m_graph(graph), m_pass(pass) {}
+        FrameGraph& m_graph;
+        int m_pass;
+    };
+
+    using Setup = std::function<void(PassBuilder&)>;
+    using Execute = std::function<void()>;
+
+    // Clears last frame's passes and resources; the dump is kept until execute()
+    void reset();
+
+    // Externally owned texture (e.g. the default framebuffer as 0). Passes
+    // writing imported resources are never culled.
+    Resource import(const std::string& name, GLuint texture);
+    void addPass(const std::string& name, const Setup& setup, Execute execute);
+
+    // Pass with per-pass data: setup(Data&, PassBuilder&) runs immediately and
+    // records the resources it declares in Data, which execute(const Data&)
+    // receives later. The returned Data lets later passes' setup read them.
+    template <typename Data, typename SetupFn, typename ExecuteFn>
+    const Data& addPass(const std::string& name, SetupFn setup, ExecuteFn execute) {
+        auto data = std::make_shared<Data>();
+        addPass(name, [&](PassBuilder& b) { setup(*data, b); },
+                [data, execute] { execute(*data); });
+        return *data;
+    }
+
+    void execute(RenderTargetPool& pool, GpuProfiler* profiler = nullptr);
+
+    // Texture behind a resource; only valid inside the execute callbacks
+    GLuint texture(Resource r) const { return m_resources[r].texture; }
+
+    // Last executed frame
+    const std::string& dump() const { return m_dump; }
+    size_t peakBytes() const { return m_peakBytes; }
+    // Changes whenever the set of passes or resource descriptions changes
+    size_t layoutHash() const { return m_layoutHash; }
+
+private:
+    struct ResourceNode {
+        std::string name;
+        TextureDesc desc;
+        bool imported;
+        GLuint texture;
+        int producer = -1; // last pass writing it
+        int readers = 0;   // live passes reading it, during culling
+        int first = -1;    // first and last live pass using it
+        int last = -1;
+    };
+
+    struct PassNode {
+        std::string name;
+        Execute execute;
+        std::vector<Resource> creates, reads, writes;
+        bool sideEffect = false;
+        int refCount = 0;
+        bool culled = false;
+    };
+
+    std::vector<ResourceNode> m_resources;
+    std::vector<PassNode> m_passes;
+
+    std::string m_dump;
+    size_t m_peakBytes = 0;
+    size_t m_layoutHash = 0;
+
+    void cull();
+    void computeLifetimes();
+    void writeDump(const std::vector<size_t>& liveBytes, const RenderTargetPool& pool);
+};
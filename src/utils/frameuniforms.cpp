@@ -0,0 +1,36 @@
+#include "frameuniforms.h"
+#include "glstate.h"
+
+void FrameUniforms::init() {
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, ubo);
+}
+
+void FrameUniforms::destroy() {
+    glDeleteBuffers(1, &ubo);
+    ubo = 0;
+}
+
+void FrameUniforms::update(const glm::mat4 &view, const glm::mat4 &proj, const glm::vec3 &camPos) {
+    Block block;
+    block.view = view;
+    block.proj = proj;
+    block.viewProj = proj * view;
+    block.invViewProj = glm::inverse(block.viewProj);
+    block.camPos = glm::vec4(camPos, 1.f);
+
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    GLState::current().bufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, BINDING, ubo);
+}
+
+void FrameUniforms::attach(GLuint program) {
+    GLuint index = glGetUniformBlockIndex(program, "FrameData");
+    if (index != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, index, BINDING);
+    }
+}
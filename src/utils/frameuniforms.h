@@ -0,0 +1,31 @@
+#pragma once
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+// Per-frame camera state shared by every shader through the std140 "FrameData"
+// uniform block, uploaded once per frame instead of once per draw.
+class FrameUniforms {
+public:
+    static constexpr GLuint BINDING = 0;
+
+    // Must match the FrameData block declared in the shaders (std140)
+    struct Block {
+        glm::mat4 view;
+        glm::mat4 proj;
+        glm::mat4 viewProj;
+        glm::mat4 invViewProj; // reconstructs world position from G-buffer depth
+        glm::vec4 camPos; // w unused
+    };
+
+    GLuint ubo = 0;
+
+    void init();
+    void destroy();
+    void update(const glm::mat4 &view, const glm::mat4 &proj, const glm::vec3 &camPos);
+
+    // Points a linked program's FrameData block at BINDING, if it uses one
+    static void attach(GLuint program);
+};
@@ -0,0 +1,105 @@
+#include "frustumculler.h"
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FRUSTUM_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Large enough to straddle every plane, small enough that |n| * extent stays finite
+constexpr float UNBOUNDED_EXTENT = 1e30f;
+
+} // namespace
+
+void frustumPlanes(const glm::mat4 &viewProj, glm::vec4 planes[6]) {
+    // Each plane is the last row plus or minus another row
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++) row[i] = glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+    for (int i = 0; i < 3; i++) {
+        planes[2 * i] = row[3] + row[i];
+        planes[2 * i + 1] = row[3] - row[i];
+    }
+}
+
+void FrustumCuller::setBoxes(const std::vector<glm::vec3> &mins, const std::vector<glm::vec3> &maxs) {
+    m_count = mins.size();
+    size_t padded = (m_count + 3) & ~size_t(3);
+    for (std::vector<float> *v : {&m_cx, &m_cy, &m_cz, &m_ex, &m_ey, &m_ez}) v->assign(padded, 0.f);
+
+    for (size_t i = 0; i < m_count; i++) {
+        glm::vec3 lo = mins[i], hi = maxs[i];
+        glm::vec3 c(0.f), e(UNBOUNDED_EXTENT);
+        if (std::isfinite(lo.x + lo.y + lo.z + hi.x + hi.y + hi.z)) {
+            c = 0.5f * (lo + hi);
+            e = 0.5f * (hi - lo);
+        }
+        m_cx[i] = c.x, m_cy[i] = c.y, m_cz[i] = c.z;
+        m_ex[i] = e.x, m_ey[i] = e.y, m_ez[i] = e.z;
+    }
+}
+
+void FrustumCuller::cull(const glm::mat4 &viewProj, const glm::mat4 &proj, const glm::vec3 &eye, float minRadius,
+                         std::vector<uint8_t> &visible) const {
+    glm::vec4 planes[6];
+    frustumPlanes(viewProj, planes);
+
+    // Projected radius r * P11 / distance < minRadius, squared and without the divide
+    float sizeScale = minRadius > 0.f ? proj[1][1] / minRadius : 0.f;
+    float sizeScale2 = sizeScale * sizeScale;
+
+    visible.resize(m_count);
+    size_t i = 0;
+#ifdef FRUSTUM_SSE2
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 px[6], py[6], pz[6], pw[6], ax[6], ay[6], az[6];
+    for (int p = 0; p < 6; p++) {
+        px[p] = _mm_set1_ps(planes[p].x), py[p] = _mm_set1_ps(planes[p].y);
+        pz[p] = _mm_set1_ps(planes[p].z), pw[p] = _mm_set1_ps(planes[p].w);
+        ax[p] = _mm_and_ps(px[p], signMask), ay[p] = _mm_and_ps(py[p], signMask), az[p] = _mm_and_ps(pz[p], signMask);
+    }
+    const __m128 ex4 = _mm_set1_ps(eye.x), ey4 = _mm_set1_ps(eye.y), ez4 = _mm_set1_ps(eye.z);
+    const __m128 scale2 = _mm_set1_ps(sizeScale2);
+
+    for (; i < m_count; i += 4) {
+        __m128 cx = _mm_loadu_ps(&m_cx[i]), cy = _mm_loadu_ps(&m_cy[i]), cz = _mm_loadu_ps(&m_cz[i]);
+        __m128 ex = _mm_loadu_ps(&m_ex[i]), ey = _mm_loadu_ps(&m_ey[i]), ez = _mm_loadu_ps(&m_ez[i]);
+
+        // A box is outside a plane when even its corner furthest along the
+        // normal is behind it: n.c + w + |n|.e < 0
+        __m128 outside = zero;
+        for (int p = 0; p < 6; p++) {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], cx), _mm_mul_ps(py[p], cy)),
+                                  _mm_add_ps(_mm_mul_ps(pz[p], cz), pw[p]));
+            __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), zero));
+        }
+
+        if (sizeScale2 > 0.f) {
+            __m128 dx = _mm_sub_ps(cx, ex4), dy = _mm_sub_ps(cy, ey4), dz = _mm_sub_ps(cz, ez4);
+            __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            __m128 radius2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)), _mm_mul_ps(ez, ez));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_mul_ps(radius2, scale2), dist2));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (size_t k = 0; k < 4 && i + k < m_count; k++) visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+    }
+#else
+    for (; i < m_count; i++) {
+        glm::vec3 c(m_cx[i], m_cy[i], m_cz[i]), e(m_ex[i], m_ey[i], m_ez[i]);
+        bool outside = false;
+        for (int p = 0; p < 6 && !outside; p++) {
+            glm::vec3 n(planes[p]);
+            outside = glm::dot(n, c) + planes[p].w + glm::dot(glm::abs(n), e) < 0.f;
+        }
+        if (!outside && sizeScale2 > 0.f) {
+            glm::vec3 d = c - eye;
+            outside = glm::dot(e, e) * sizeScale2 < glm::dot(d, d);
+        }
+        visible[i] = outside ? 0 : 1;
+    }
+#endif
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// The six planes of viewProj's frustum (Gribb-Hartmann), xyz pointing inwards.
+// They are not normalised, so only the sign of a plane distance is meaningful.
+void frustumPlanes(const glm::mat4 &viewProj, glm::vec4 planes[6]);
+
+// Tests world-space boxes against a view frustum, four at a time. Boxes are kept
+// as centre and half extents in structure-of-arrays form, padded to a multiple
+// of four, so each plane is tested against four boxes with one SSE2 sequence.
+class FrustumCuller {
+public:
+    // Replaces the boxes; non-finite boxes are never culled
+    void setBoxes(const std::vector<glm::vec3> &mins, const std::vector<glm::vec3> &maxs);
+    size_t size() const { return m_count; }
+
+    // Sets visible[i] to 1 if box i may be on screen, 0 if it is not
+    // @param viewProj  proj * view
+    // @param eye       camera position, for small-object culling
+    // @param minRadius boxes whose bounding sphere projects to a radius below
+    //                  this many NDC units (vertically) are culled too; 0 disables
+    void cull(const glm::mat4 &viewProj, const glm::mat4 &proj, const glm::vec3 &eye, float minRadius,
+              std::vector<uint8_t> &visible) const;
+
+private:
+    size_t m_count = 0;
+    std::vector<float> m_cx, m_cy, m_cz; // centres
+    std::vector<float> m_ex, m_ey, m_ez; // half extents
+};
@@ -1,59 +1,45 @@
 #include "gbuffer.h"
+#include "glstate.h"
 #include <GL/glew.h>
 
-void GBuffer::init(int w, int h) {
-    glGenFramebuffers(1, &fbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-    glGenTextures(1, &texPosition);
-    glBindTexture(GL_TEXTURE_2D, texPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, w, h, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texPosition, 0);
-
-    glGenTextures(1, &texNormal);
-    glBindTexture(GL_TEXTURE_2D, texNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, w, h, 0, GL_RGBA, GL_FLOAT, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, texNormal, 0);
-
-    glGenTextures(1, &texAlbedo);
-    glBindTexture(GL_TEXTURE_2D, texAlbedo);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, texAlbedo, 0);
-
-    glGenTextures(1, &texEmissive);
-    glBindTexture(GL_TEXTURE_2D, texEmissive);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, texEmissive, 0);
-
-    GLuint attachments[4] = {
+void GBuffer::init(RenderTargetPool* pool) {
+    m_pool = pool;
+    fbo = m_pool->acquireFramebuffer();
+}
+
+void GBuffer::attach(GLuint depth, GLuint normal, GLuint albedo, GLuint emissive) {
+    GLState& gl = GLState::current();
+    texDepth = depth;
+    texNormal = normal;
+    texAlbedo = albedo;
+    texEmissive = emissive;
+
+    gl.bindFramebuffer(fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texNormal, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, texAlbedo, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, texEmissive, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texDepth, 0);
+
+    GLuint attachments[3] = {
         GL_COLOR_ATTACHMENT0,
         GL_COLOR_ATTACHMENT1,
-        GL_COLOR_ATTACHMENT2,
-        GL_COLOR_ATTACHMENT3
+        GL_COLOR_ATTACHMENT2
     };
-    glDrawBuffers(4, attachments);
-
-    glGenRenderbuffers(1, &depthRBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, w, h);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+    glDrawBuffers(hasEmissive() ? 3 : 2, attachments);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl.bindFramebuffer(0);
 }
 
 void GBuffer::bind() {
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    GLState::current().bindFramebuffer(fbo);
 }
 
 void GBuffer::unbind() {
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::current().bindFramebuffer(0);
 }
 
+void GBuffer::destroy() {
+    if (!m_pool) return;
+    m_pool->releaseFramebuffer(fbo);
+    fbo = texNormal = texAlbedo = texDepth = texEmissive = 0;
+}
@@ -4,16 +4,37 @@
 #endif
 #include <GL/glew.h>
 
+#include "rendertargetpool.h"
+
+// Compact G-buffer, 12 bytes per pixel (16 with emissive) instead of 28:
+//   texDepth     DEPTH24    world position is reconstructed from it
+//   texNormal    RG16       octahedral-encoded world normal
+//   texAlbedo    RGBA8      diffuse colour, alpha spare
+//   texEmissive  RGBA8      only used while the scene has emissive materials
+// The textures are frame-graph transients (see Realtime::buildFrameGraph) and
+// are attached each frame; GBuffer only keeps the framebuffer.
 class GBuffer {
 public:
-    GLuint fbo;
-    GLuint texPosition;
-    GLuint texNormal;
-    GLuint texAlbedo;
-    GLuint texEmissive;
-    GLuint depthRBO;
+    static constexpr GLenum DEPTH_FORMAT = GL_DEPTH_COMPONENT24;
+    static constexpr GLenum NORMAL_FORMAT = GL_RG16;
+    static constexpr GLenum ALBEDO_FORMAT = GL_RGBA8;
+    static constexpr GLenum EMISSIVE_FORMAT = GL_RGBA8;
+
+    GLuint fbo = 0;
+    GLuint texDepth = 0;
+    GLuint texNormal = 0;
+    GLuint texAlbedo = 0;
+    GLuint texEmissive = 0;
 
-    void init(int w, int h);
+    void init(RenderTargetPool* pool);
+    // Points the framebuffer at this frame's targets; emissive may be 0. Always
+    // re-attaches, since a trimmed texture's name can come back as a new texture.
+    void attach(GLuint depth, GLuint normal, GLuint albedo, GLuint emissive);
+    bool hasEmissive() const { return texEmissive != 0; }
     void bind();
     void unbind();
+    void destroy();
+
+private:
+    RenderTargetPool* m_pool = nullptr;
 };
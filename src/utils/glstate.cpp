@@ -0,0 +1,85 @@
+#include "glstate.h"
+#include <algorithm>
+#include <iterator>
+
+GLState& GLState::current() {
+    thread_local GLState state;
+    return state;
+}
+
+void GLState::beginFrame() {
+    m_stats = Stats();
+    forget();
+    m_tracking = true;
+}
+
+void GLState::endFrame() {
+    // Draws leave their vertex array bound; unbind it so index buffer bindings
+    // made between frames can't end up recorded in it
+    bindVertexArray(0);
+    m_tracking = false;
+}
+
+void GLState::forget() {
+    m_program = m_vao = m_fbo = m_unit = UNKNOWN;
+    std::fill(std::begin(m_texture2D), std::end(m_texture2D), UNKNOWN);
+    std::fill(std::begin(m_textureBuffer), std::end(m_textureBuffer), UNKNOWN);
+}
+
+bool GLState::change(GLuint& cached, GLuint value) {
+    if (m_tracking && cached == value) {
+        m_stats.redundant++;
+        return false;
+    }
+    cached = value;
+    m_stats.stateChanges++;
+    return true;
+}
+
+void GLState::useProgram(GLuint program) {
+    if (change(m_program, program)) glUseProgram(program);
+}
+
+void GLState::bindVertexArray(GLuint vao) {
+    if (change(m_vao, vao)) glBindVertexArray(vao);
+}
+
+void GLState::activeTexture(GLenum unit) {
+    if (change(m_unit, unit - GL_TEXTURE0)) glActiveTexture(unit);
+}
+
+void GLState::bindTexture(GLenum target, GLuint texture) {
+    GLuint* cached = nullptr;
+    if (m_unit < UNITS) {
+        if (target == GL_TEXTURE_2D) cached = &m_texture2D[m_unit];
+        else if (target == GL_TEXTURE_BUFFER) cached = &m_textureBuffer[m_unit];
+    }
+    GLuint untracked = UNKNOWN;
+    if (change(cached ? *cached : untracked, texture)) glBindTexture(target, texture);
+}
+
+void GLState::bindFramebuffer(GLuint fbo) {
+    if (change(m_fbo, fbo)) glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+}
+
+void GLState::drawArrays(GLenum mode, GLint first, GLsizei count) {
+    glDrawArrays(mode, first, count);
+    m_stats.drawCalls++;
+}
+
+void GLState::drawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances) {
+    glDrawElementsInstanced(mode, count, type, indices, instances);
+    m_stats.drawCalls++;
+}
+
+void GLState::bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    glBufferData(target, size, data, usage);
+    m_stats.bufferUploads++;
+    m_stats.bufferBytes += size;
+}
+
+void GLState::bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+    glBufferSubData(target, offset, size, data);
+    m_stats.bufferUploads++;
+    m_stats.bufferBytes += size;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <cstdint>
+
+// Caches the bindings a frame changes most (program, vertex array, active
+// texture unit, 2D and buffer textures per unit, framebuffer) and drops calls
+// that would rebind what is already bound. Also counts draws, bindings, uniform
+// uploads and buffer uploads made through it.
+//
+// Tracking is on only between beginFrame() and endFrame(). Between frames Qt
+// binds its own framebuffer and resources are created and deleted (freeing
+// names for reuse), so outside a frame every call goes straight to GL. Inside
+// one, every binding of the kinds above must go through here.
+//
+// One per thread, matching the one current GL context per thread.
+class GLState {
+public:
+    // Calls made through GLState since beginFrame()
+    struct Stats {
+        int drawCalls = 0;
+        int stateChanges = 0;   // bindings passed to GL
+        int redundant = 0;      // bindings dropped as already set
+        int uniformUploads = 0; // ShaderProgram::set() calls that reached GL
+        int bufferUploads = 0;
+        int64_t bufferBytes = 0;
+    };
+
+    static GLState& current();
+
+    // Starts tracking from unknown bindings and clears the counters
+    void beginFrame();
+    void endFrame();
+    const Stats& stats() const { return m_stats; }
+
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vao);
+    void activeTexture(GLenum unit);
+    // On the active unit; targets other than 2D and buffer textures are not cached
+    void bindTexture(GLenum target, GLuint texture);
+    // GL_FRAMEBUFFER, i.e. both draw and read
+    void bindFramebuffer(GLuint fbo);
+
+    void drawArrays(GLenum mode, GLint first, GLsizei count);
+    void drawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances);
+    void bufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+    void bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+    void countUniformUpload() { m_stats.uniformUploads++; }
+
+private:
+    static constexpr GLuint UNKNOWN = ~0u;
+    static constexpr int UNITS = 16;
+
+    bool m_tracking = false;
+    GLuint m_program = UNKNOWN;
+    GLuint m_vao = UNKNOWN;
+    GLuint m_fbo = UNKNOWN;
+    GLuint m_unit = UNKNOWN; // index from GL_TEXTURE0
+    GLuint m_texture2D[UNITS];
+    GLuint m_textureBuffer[UNITS];
+    Stats m_stats;
+
+    void forget();
+    // Records value as bound and returns true if the call has to be made
+    bool change(GLuint& cached, GLuint value);
+};
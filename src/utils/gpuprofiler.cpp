@@ -0,0 +1,137 @@
+#include "gpuprofiler.h"
+#include <algorithm>
+
+void GpuProfiler::init() {
+    for (Slot& slot : m_slots) slot = Slot();
+    m_current = 0;
+    m_frame = 0;
+}
+
+void GpuProfiler::destroy() {
+    for (Slot& slot : m_slots) {
+        if (!slot.queries.empty()) glDeleteQueries(GLsizei(slot.queries.size()), slot.queries.data());
+        slot = Slot();
+    }
+}
+
+int GpuProfiler::intern(const std::string& name) {
+    auto it = std::find(m_names.begin(), m_names.end(), name);
+    if (it != m_names.end()) return int(it - m_names.begin());
+    m_names.push_back(name);
+    return int(m_names.size()) - 1;
+}
+
+GLuint GpuProfiler::nextQuery(Slot& slot) {
+    if (slot.used == slot.queries.size()) {
+        GLuint q;
+        glGenQueries(1, &q);
+        slot.queries.push_back(q);
+    }
+    return slot.queries[slot.used++];
+}
+
+void GpuProfiler::beginFrame() {
+    // Slots are resolved oldest first; stop at the first one still in flight
+    for (int i = 1; i <= FRAMES_IN_FLIGHT; i++) {
+        Slot& slot = m_slots[(m_current + i) % FRAMES_IN_FLIGHT];
+        if (!slot.pending) continue;
+
+        GLint available = GL_FALSE;
+        if (slot.last) glGetQueryObjectiv(slot.last, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available && slot.last) break;
+        resolve(slot);
+    }
+
+    m_current = (m_current + 1) % FRAMES_IN_FLIGHT;
+    Slot& slot = m_slots[m_current];
+    if (slot.pending) {
+        // Still not back after FRAMES_IN_FLIGHT frames; drop it rather than wait
+        slot.pending = false;
+    }
+    slot.frame = m_frame++;
+    slot.samples.clear();
+    slot.used = 0;
+    slot.last = 0;
+    m_open.clear();
+}
+
+void GpuProfiler::endFrame() {
+    while (!m_open.empty()) end();
+    m_slots[m_current].pending = true;
+}
+
+void GpuProfiler::flush() {
+    for (int i = 1; i <= FRAMES_IN_FLIGHT; i++) {
+        Slot& slot = m_slots[(m_current + i) % FRAMES_IN_FLIGHT];
+        if (slot.pending) resolve(slot);
+    }
+}
+
+void GpuProfiler::begin(const std::string& name) {
+    Slot& slot = m_slots[m_current];
+    Sample sample{intern(name), nextQuery(slot), nextQuery(slot)};
+    glQueryCounter(sample.begin, GL_TIMESTAMP);
+    slot.last = sample.begin;
+    m_open.push_back(int(slot.samples.size()));
+    slot.samples.push_back(sample);
+}
+
+void GpuProfiler::end() {
+    if (m_open.empty()) return;
+    Slot& slot = m_slots[m_current];
+    GLuint query = slot.samples[m_open.back()].end;
+    glQueryCounter(query, GL_TIMESTAMP);
+    slot.last = query;
+    m_open.pop_back();
+}
+
+void GpuProfiler::resolve(Slot& slot) {
+    Frame frame{slot.frame, std::vector<float>(m_names.size(), 0.f)};
+    for (const Sample& s : slot.samples) {
+        GLuint64 t0 = 0, t1 = 0;
+        glGetQueryObjectui64v(s.begin, GL_QUERY_RESULT, &t0);
+        glGetQueryObjectui64v(s.end, GL_QUERY_RESULT, &t1);
+        // A scope that runs twice in a frame is reported as its total
+        frame.ms[s.id] += float(double(t1 - t0) * 1e-6);
+    }
+    slot.pending = false;
+
+    m_history.push_back(std::move(frame));
+    if (m_history.size() > HISTORY) m_history.pop_front();
+}
+
+float GpuProfiler::average(int id) const {
+    if (m_history.empty()) return 0.f;
+    float sum = 0.f;
+    for (const Frame& f : m_history) {
+        if (id < int(f.ms.size())) sum += f.ms[id];
+    }
+    return sum / m_history.size();
+}
+
+void GpuProfiler::writeCsv(std::ostream& out) const {
+    out << "frame,scope,ms\n";
+    for (const Frame& f : m_history) {
+        for (size_t id = 0; id < f.ms.size(); id++) {
+            if (f.ms[id] > 0.f) out << f.index << "," << m_names[id] << "," << f.ms[id] << "\n";
+        }
+    }
+}
+
+void GpuProfiler::writeJson(std::ostream& out) const {
+    // Scope names are chosen in code and never need escaping
+    out << "{\"scopes\":[";
+    for (size_t id = 0; id < m_names.size(); id++) {
+        out << (id ? "," : "") << "\"" << m_names[id] << "\"";
+    }
+    out << "],\"frames\":[";
+    for (size_t i = 0; i < m_history.size(); i++) {
+        const Frame& f = m_history[i];
+        out << (i ? "," : "") << "{\"frame\":" << f.index << ",\"ms\":[";
+        for (size_t id = 0; id < m_names.size(); id++) {
+            out << (id ? "," : "") << (id < f.ms.size() ? f.ms[id] : 0.f);
+        }
+        out << "]}";
+    }
+    out << "]}\n";
+}
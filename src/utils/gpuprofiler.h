@@ -0,0 +1,97 @@
+#pragma once
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// GPU time per named scope, measured with GL_TIMESTAMP query pairs. Queries
+// issued in one frame are read FRAMES_IN_FLIGHT - 1 frames later, and only once
+// GL_QUERY_RESULT_AVAILABLE says so, so reading never stalls the pipeline.
+// Resolved frames are kept in a rolling history for the HUD and the loggers.
+class GpuProfiler {
+public:
+    static constexpr int FRAMES_IN_FLIGHT = 3;
+    static constexpr int HISTORY = 240;
+
+    struct Frame {
+        uint64_t index;
+        std::vector<float> ms; // per scope id, 0 if it did not run
+    };
+
+    // Times a scope for as long as it lives
+    class Scope {
+    public:
+        Scope(GpuProfiler* profiler, const std::string& name) : m_profiler(profiler) {
+            if (m_profiler) m_profiler->begin(name);
+        }
+        ~Scope() {
+            if (m_profiler) m_profiler->end();
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        GpuProfiler* m_profiler;
+    };
+
+    void init();
+    void destroy();
+
+    // Resolves whatever earlier frames have finished, then starts recording
+    void beginFrame();
+    void endFrame();
+    // Waits for every frame still in flight and resolves it; for benchmarks
+    // and captures, never per frame
+    void flush();
+
+    // Scopes may nest; prefer Scope over calling these directly
+    void begin(const std::string& name);
+    void end();
+
+    // Scope names, indexed by the ids used in Frame::ms
+    const std::vector<std::string>& names() const { return m_names; }
+    // Oldest first
+    const std::deque<Frame>& history() const { return m_history; }
+    // Mean over the history, in ms
+    float average(int id) const;
+
+    // Rolling history as "frame,scope,ms" rows
+    void writeCsv(std::ostream& out) const;
+    // Rolling history as {"scopes":[...],"frames":[{"frame":n,"ms":[...]}]}
+    void writeJson(std::ostream& out) const;
+
+private:
+    struct Sample {
+        int id;
+        GLuint begin;
+        GLuint end;
+    };
+
+    struct Slot {
+        uint64_t frame = 0;
+        bool pending = false;
+        std::vector<Sample> samples;
+        std::vector<GLuint> queries; // pool, reused once the slot resolves
+        size_t used = 0;
+        // Issued after every other query of the frame, so once it is available
+        // they all are (the outermost scope ends last, not the last sample)
+        GLuint last = 0;
+    };
+
+    Slot m_slots[FRAMES_IN_FLIGHT];
+    int m_current = 0;
+    uint64_t m_frame = 0;
+    std::vector<int> m_open; // sample indices of unclosed scopes
+
+    std::vector<std::string> m_names;
+    std::deque<Frame> m_history;
+
+    int intern(const std::string& name);
+    GLuint nextQuery(Slot& slot);
+    void resolve(Slot& slot);
+};
@@ -0,0 +1,232 @@
+#include "hizbuffer.h"
+#include "glstate.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void HiZBuffer::init() {
+    m_reduceShader = std::make_unique<ShaderProgram>(
+        ":/resources/shaders/fullscreen_quad.vert",
+        ":/resources/shaders/hizReduce.frag");
+    m_reduceShader->use();
+    m_reduceShader->setUniform1i("depthTex", 0);
+    m_reduceShader->setUniform1i("blockSize", BLOCK);
+    GLState::current().useProgram(0);
+
+    glGenFramebuffers(1, &m_fbo);
+    for (Slot& slot : m_slots) glGenBuffers(1, &slot.pbo);
+    initQuad();
+}
+
+void HiZBuffer::initQuad() {
+    GLState& gl = GLState::current();
+    float verts[] = {
+        -1.f, -1.f, 0.f, 0.f, 0.f,
+        1.f, -1.f, 0.f, 1.f, 0.f,
+        -1.f,  1.f, 0.f, 0.f, 1.f,
+        1.f,  1.f, 0.f, 1.f, 1.f
+    };
+
+    glGenVertexArrays(1, &m_quadVAO);
+    glGenBuffers(1, &m_quadVBO);
+
+    gl.bindVertexArray(m_quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(3*sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    gl.bindVertexArray(0);
+}
+
+void HiZBuffer::resize(int width, int height) {
+    GLState& gl = GLState::current();
+    invalidate();
+
+    // Level sizes, from one texel per block up to 1x1
+    m_pixels = glm::ivec2(width, height);
+    m_sizes.clear();
+    m_levels.clear();
+    // A minimised window; capture() does nothing until the next resize
+    if (width <= 0 || height <= 0) {
+        m_width = m_height = 0;
+        return;
+    }
+    glm::ivec2 size((width + BLOCK - 1) / BLOCK, (height + BLOCK - 1) / BLOCK);
+    m_width = size.x;
+    m_height = size.y;
+    while (true) {
+        m_sizes.push_back(size);
+        m_levels.emplace_back(size_t(size.x) * size.y, 1.f);
+        if (size == glm::ivec2(1)) break;
+        size = (size + 1) / 2;
+    }
+
+    glDeleteTextures(1, &m_tex);
+    glGenTextures(1, &m_tex);
+    gl.bindTexture(GL_TEXTURE_2D, m_tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, m_width, m_height, 0, GL_RED, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gl.bindTexture(GL_TEXTURE_2D, 0);
+
+    gl.bindFramebuffer(m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_tex, 0);
+    gl.bindFramebuffer(0);
+
+    for (Slot& slot : m_slots) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, m_levels[0].size() * sizeof(float), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void HiZBuffer::destroy() {
+    for (Slot& slot : m_slots) {
+        releaseSlot(slot);
+        glDeleteBuffers(1, &slot.pbo);
+        slot.pbo = 0;
+    }
+    glDeleteFramebuffers(1, &m_fbo);
+    glDeleteTextures(1, &m_tex);
+    glDeleteVertexArrays(1, &m_quadVAO);
+    glDeleteBuffers(1, &m_quadVBO);
+    m_fbo = m_tex = m_quadVAO = m_quadVBO = 0;
+    m_reduceShader.reset();
+    m_ready = false;
+}
+
+void HiZBuffer::invalidate() {
+    m_generation++;
+    m_ready = false;
+}
+
+void HiZBuffer::releaseSlot(Slot& slot) {
+    if (slot.fence) glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+}
+
+void HiZBuffer::capture(GLuint depthTex, const glm::mat4& viewProj) {
+    if (m_width == 0) return;
+
+    // Still not back after FRAMES_IN_FLIGHT frames; drop it rather than wait
+    Slot& slot = m_slots[m_next];
+    releaseSlot(slot);
+    m_next = (m_next + 1) % FRAMES_IN_FLIGHT;
+
+    GLState& gl = GLState::current();
+    gl.bindFramebuffer(m_fbo);
+    glViewport(0, 0, m_width, m_height);
+    glDisable(GL_DEPTH_TEST);
+    m_reduceShader->use();
+    gl.activeTexture(GL_TEXTURE0);
+    gl.bindTexture(GL_TEXTURE_2D, depthTex);
+    gl.bindVertexArray(m_quadVAO);
+    gl.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    // Into the pixel buffer; the copy completes asynchronously
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+    glReadPixels(0, 0, m_width, m_height, GL_RED, GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    gl.bindFramebuffer(0);
+    glViewport(0, 0, m_pixels.x, m_pixels.y);
+
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.viewProj = viewProj;
+    slot.generation = m_generation;
+    m_captured = true;
+}
+
+void HiZBuffer::update() {
+    // Nothing captured last frame (occlusion culling or the pass was off), so
+    // the pyramid no longer follows the scene; don't use it once captures resume
+    if (!m_captured) invalidate();
+    m_captured = false;
+
+    // Oldest first, stopping at the first readback still in flight; only the
+    // newest finished one is kept
+    Slot* newest = nullptr;
+    for (int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+        Slot& slot = m_slots[(m_next + i) % FRAMES_IN_FLIGHT];
+        if (!slot.fence) continue;
+        GLenum status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+        releaseSlot(slot);
+        if (slot.generation == m_generation) newest = &slot;
+    }
+    if (!newest) return;
+
+    std::vector<float>& base = m_levels[0];
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, newest->pbo);
+    const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, base.size() * sizeof(float), GL_MAP_READ_BIT);
+    if (data) {
+        std::memcpy(base.data(), data, base.size() * sizeof(float));
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        m_viewProj = newest->viewProj;
+        buildPyramid();
+        m_ready = true;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void HiZBuffer::buildPyramid() {
+    for (size_t l = 1; l < m_levels.size(); l++) {
+        const std::vector<float>& src = m_levels[l - 1];
+        std::vector<float>& dst = m_levels[l];
+        glm::ivec2 srcSize = m_sizes[l - 1], size = m_sizes[l];
+        for (int y = 0; y < size.y; y++) {
+            int y0 = 2 * y, y1 = std::min(2 * y + 1, srcSize.y - 1);
+            for (int x = 0; x < size.x; x++) {
+                int x0 = 2 * x, x1 = std::min(2 * x + 1, srcSize.x - 1);
+                dst[size_t(y) * size.x + x] = std::max({src[size_t(y0) * srcSize.x + x0], src[size_t(y0) * srcSize.x + x1],
+                                                        src[size_t(y1) * srcSize.x + x0], src[size_t(y1) * srcSize.x + x1]});
+            }
+        }
+    }
+}
+
+bool HiZBuffer::visible(const glm::vec3& lo, const glm::vec3& hi) const {
+    if (!m_ready || !std::isfinite(lo.x + lo.y + lo.z + hi.x + hi.y + hi.z)) return true;
+
+    // Screen rectangle and nearest depth of the box in the pyramid's frame
+    glm::vec2 ndcLo(1e30f), ndcHi(-1e30f);
+    float nearest = 1e30f;
+    for (int k = 0; k < 8; k++) {
+        glm::vec3 p(k & 1 ? hi.x : lo.x, k & 2 ? hi.y : lo.y, k & 4 ? hi.z : lo.z);
+        glm::vec4 clip = m_viewProj * glm::vec4(p, 1.f);
+        // Reaches the camera plane: nothing in front of it can hide it
+        if (clip.w <= 1e-5f) return true;
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        ndcLo = glm::min(ndcLo, glm::vec2(ndc));
+        ndcHi = glm::max(ndcHi, glm::vec2(ndc));
+        nearest = std::min(nearest, ndc.z);
+    }
+    // Anything outside that frame's view or before its near plane has no depth to test against
+    if (ndcLo.x < -1.f || ndcLo.y < -1.f || ndcHi.x > 1.f || ndcHi.y > 1.f || nearest < -1.f) return true;
+    float depth = 0.5f * nearest + 0.5f;
+
+    // Level-0 texels covered; each holds BLOCK x BLOCK pixels
+    glm::vec2 scale = glm::vec2(m_pixels) * (0.5f / BLOCK);
+    glm::ivec2 last(m_width - 1, m_height - 1);
+    glm::ivec2 t0 = glm::clamp(glm::ivec2(glm::floor((ndcLo + 1.f) * scale)), glm::ivec2(0), last);
+    glm::ivec2 t1 = glm::clamp(glm::ivec2(glm::floor((ndcHi + 1.f) * scale)), glm::ivec2(0), last);
+
+    // Coarsest level at which the rectangle still spans at most 2x2 texels
+    int level = 0;
+    while (level + 1 < int(m_levels.size()) && ((t1.x >> level) - (t0.x >> level) > 1 || (t1.y >> level) - (t0.y >> level) > 1)) {
+        level++;
+    }
+    const std::vector<float>& texels = m_levels[level];
+    int w = m_sizes[level].x;
+    float farthest = 0.f;
+    for (int y = t0.y >> level; y <= t1.y >> level; y++) {
+        for (int x = t0.x >> level; x <= t1.x >> level; x++) {
+            farthest = std::max(farthest, texels[size_t(y) * w + x]);
+        }
+    }
+    return depth <= farthest;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "shaderprogram.h"
+
+// Hierarchical-Z occlusion culling against the depth of an earlier frame.
+// capture() reduces a depth buffer on the GPU to its farthest depth per
+// BLOCK x BLOCK pixels and reads that back through a ring of pixel buffers;
+// update() picks up finished readbacks without waiting (fences, as GpuProfiler
+// does with its queries) and builds the rest of the max-depth pyramid on the
+// CPU. Boxes are tested in the view-projection the depth was rendered with, so
+// results trail the camera by a frame or two: a shape uncovered by camera
+// motion can appear a frame late.
+class HiZBuffer {
+public:
+    static constexpr int BLOCK = 8;
+    static constexpr int FRAMES_IN_FLIGHT = 3;
+
+    void init();
+    // @param width, height size of the depth buffers passed to capture()
+    void resize(int width, int height);
+    void destroy();
+    // Drops the pyramid and any readback in flight, e.g. when the scene changes
+    void invalidate();
+
+    // Reduces depthTex (window-space depth) and queues its readback
+    // @param viewProj the matrix the depth was rendered with
+    void capture(GLuint depthTex, const glm::mat4& viewProj);
+    // Takes the newest finished readback, if any; call once per frame before testing.
+    // A frame without a capture() drops the pyramid, as for invalidate().
+    void update();
+
+    bool ready() const { return m_ready; }
+    const glm::mat4& viewProj() const { return m_viewProj; }
+    // False only if the box lies entirely behind the pyramid's depth
+    bool visible(const glm::vec3& lo, const glm::vec3& hi) const;
+
+private:
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        glm::mat4 viewProj;
+        uint64_t generation = 0;
+    };
+
+    std::unique_ptr<ShaderProgram> m_reduceShader;
+    GLuint m_fbo = 0, m_tex = 0;
+    GLuint m_quadVAO = 0, m_quadVBO = 0;
+
+    Slot m_slots[FRAMES_IN_FLIGHT];
+    int m_next = 0;             // slot the next capture() writes
+    uint64_t m_generation = 0;  // bumped by invalidate()
+    bool m_captured = false;    // capture() called since the last update()
+
+    // The pyramid: level 0 is one texel per block, each level above halves it
+    // (rounding up) keeping the maximum
+    glm::ivec2 m_pixels{0};     // depth buffer size
+    int m_width = 0, m_height = 0;
+    std::vector<glm::ivec2> m_sizes;
+    std::vector<std::vector<float>> m_levels;
+    glm::mat4 m_viewProj{1.f};
+    bool m_ready = false;
+
+    void releaseSlot(Slot& slot);
+    void buildPyramid();
+    void initQuad();
+};
@@ -0,0 +1,60 @@
+#include "lightbuffer.h"
+#include "glstate.h"
+#include <algorithm>
+#include <glm/glm.hpp>
+
+static int typeOrder(LightType t) {
+    switch (t) {
+    case LightType::LIGHT_DIRECTIONAL: return 0;
+    case LightType::LIGHT_POINT:       return 1;
+    default:                           return 2;
+    }
+}
+
+void LightBuffer::init() {
+    glGenBuffers(1, &tbo);
+    glGenTextures(1, &tex);
+}
+
+void LightBuffer::destroy() {
+    glDeleteTextures(1, &tex);
+    glDeleteBuffers(1, &tbo);
+    tex = tbo = 0;
+}
+
+void LightBuffer::upload(const std::vector<SceneLightData>& lights) {
+    GLState& gl = GLState::current();
+    m_sorted = lights;
+    std::stable_sort(m_sorted.begin(), m_sorted.end(), [](const SceneLightData& a, const SceneLightData& b) {
+        return typeOrder(a.type) < typeOrder(b.type);
+    });
+
+    numDirectional = numPoint = numSpot = 0;
+    std::vector<glm::vec4> texels;
+    texels.reserve(m_sorted.size() * TEXELS_PER_LIGHT);
+    for (const SceneLightData& L : m_sorted) {
+        switch (L.type) {
+        case LightType::LIGHT_DIRECTIONAL: numDirectional++; break;
+        case LightType::LIGHT_POINT:       numPoint++; break;
+        case LightType::LIGHT_SPOT:        numSpot++; break;
+        }
+        texels.push_back(glm::vec4(glm::vec3(L.pos), L.angle));
+        texels.push_back(glm::vec4(glm::vec3(L.dir), L.penumbra));
+        texels.push_back(glm::vec4(glm::vec3(L.color), 0.f));
+        texels.push_back(glm::vec4(L.function, 0.f));
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, tbo);
+    glBufferData(GL_TEXTURE_BUFFER, texels.size() * sizeof(glm::vec4), texels.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    gl.bindTexture(GL_TEXTURE_BUFFER, tex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, tbo);
+    gl.bindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightBuffer::bind(GLenum unit) {
+    GLState& gl = GLState::current();
+    gl.activeTexture(unit);
+    gl.bindTexture(GL_TEXTURE_BUFFER, tex);
+}
@@ -0,0 +1,38 @@
+#pragma once
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <vector>
+
+#include "sceneparser.h"
+
+// Scene lights packed into a texture buffer, so the lighting shaders take any
+// number of lights instead of a fixed uniform array. Lights are sorted by type
+// (directional, point, spot) so each shader loop handles a single type.
+// Each light occupies TEXELS_PER_LIGHT RGBA32F texels:
+//   [0] pos.xyz, angle   [1] dir.xyz, penumbra   [2] color.rgb   [3] atten.xyz
+class LightBuffer {
+public:
+    static constexpr int TEXELS_PER_LIGHT = 4;
+
+    GLuint tbo = 0;
+    GLuint tex = 0;
+
+    int numDirectional = 0;
+    int numPoint = 0;
+    int numSpot = 0;
+
+    void init();
+    void destroy();
+
+    // Call when the scene's lights change; nothing is uploaded per frame
+    void upload(const std::vector<SceneLightData>& lights);
+    void bind(GLenum unit);
+
+    // CPU copy in the uploaded (sorted) order
+    const std::vector<SceneLightData>& sorted() const { return m_sorted; }
+
+private:
+    std::vector<SceneLightData> m_sorted;
+};
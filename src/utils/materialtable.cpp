@@ -0,0 +1,74 @@
+#include "materialtable.h"
+#include "glstate.h"
+#include <cstring>
+
+size_t MaterialTable::KeyHash::operator()(const Key &k) const {
+    // FNV-1a over the raw float bits
+    size_t h = 1469598103934665603ull;
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(k.data());
+    for (size_t i = 0; i < sizeof(Key); i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+void MaterialTable::init() {
+    glGenBuffers(1, &tbo);
+    glGenTextures(1, &tex);
+}
+
+void MaterialTable::destroy() {
+    glDeleteTextures(1, &tex);
+    glDeleteBuffers(1, &tbo);
+    tex = tbo = 0;
+}
+
+int MaterialTable::intern(const SceneMaterial &mat) {
+    glm::vec4 texels[TEXELS_PER_MATERIAL] = {
+        glm::vec4(glm::vec3(mat.cAmbient), 0.f),
+        glm::vec4(glm::vec3(mat.cDiffuse), 0.f),
+        glm::vec4(glm::vec3(mat.cSpecular), mat.shininess),
+        glm::vec4(glm::vec3(mat.cEmissive), 0.f)
+    };
+
+    Key key;
+    std::memcpy(key.data(), texels, sizeof(Key));
+
+    auto it = m_lookup.find(key);
+    if (it != m_lookup.end()) return it->second;
+
+    int index = size();
+    m_texels.insert(m_texels.end(), texels, texels + TEXELS_PER_MATERIAL);
+    m_lookup.emplace(key, index);
+    return index;
+}
+
+bool MaterialTable::hasEmissive() const {
+    for (size_t i = 3; i < m_texels.size(); i += TEXELS_PER_MATERIAL) {
+        if (glm::vec3(m_texels[i]) != glm::vec3(0.f)) return true;
+    }
+    return false;
+}
+
+void MaterialTable::clear() {
+    m_texels.clear();
+    m_lookup.clear();
+}
+
+void MaterialTable::upload() {
+    GLState& gl = GLState::current();
+    glBindBuffer(GL_TEXTURE_BUFFER, tbo);
+    glBufferData(GL_TEXTURE_BUFFER, m_texels.size() * sizeof(glm::vec4), m_texels.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    gl.bindTexture(GL_TEXTURE_BUFFER, tex);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, tbo);
+    gl.bindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void MaterialTable::bind(GLenum unit) {
+    GLState& gl = GLState::current();
+    gl.activeTexture(unit);
+    gl.bindTexture(GL_TEXTURE_BUFFER, tex);
+}
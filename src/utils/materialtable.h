@@ -0,0 +1,45 @@
+#pragma once
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <unordered_map>
+#include <vector>
+
+#include "scenedata.h"
+
+// Interned scene materials, uploaded as a texture buffer so shaders can look a
+// material up by index (one per instance) instead of taking per-draw uniforms.
+// Each material occupies TEXELS_PER_MATERIAL RGBA32F texels:
+//   [0] cAmbient.rgb   [1] cDiffuse.rgb   [2] cSpecular.rgb, shininess   [3] cEmissive.rgb
+class MaterialTable {
+public:
+    static constexpr int TEXELS_PER_MATERIAL = 4;
+
+    GLuint tbo = 0;
+    GLuint tex = 0;
+
+    void init();
+    void destroy();
+
+    // Returns the index of an identical material if one was already added
+    int intern(const SceneMaterial &mat);
+    void clear();
+    void upload();
+
+    void bind(GLenum unit);
+    int size() const { return int(m_texels.size()) / TEXELS_PER_MATERIAL; }
+    // Whether any interned material has a non-zero cEmissive
+    bool hasEmissive() const;
+
+private:
+    using Key = std::array<float, TEXELS_PER_MATERIAL * 4>;
+    struct KeyHash {
+        size_t operator()(const Key &k) const;
+    };
+
+    std::vector<glm::vec4> m_texels;
+    std::unordered_map<Key, int, KeyHash> m_lookup;
+};
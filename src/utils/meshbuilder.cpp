@@ -0,0 +1,46 @@
+#include "meshbuilder.h"
+#include <cstring>
+
+size_t MeshBuilder::KeyHash::operator()(const Key &k) const {
+    // FNV-1a over the raw float bits
+    size_t h = 1469598103934665603ull;
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(k.data());
+    for (size_t i = 0; i < sizeof(Key); i++) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+void MeshBuilder::clear() {
+    m_vertices.clear();
+    m_indices.clear();
+    m_lookup.clear();
+}
+
+void MeshBuilder::reserve(size_t vertexCount, size_t cornerCount) {
+    m_vertices.reserve(vertexCount * 6);
+    m_indices.reserve(cornerCount);
+    m_lookup.reserve(vertexCount);
+}
+
+void MeshBuilder::push(const glm::vec3 &p, const glm::vec3 &n) {
+    // + 0.f folds -0 into +0 so e.g. pole vertices with r*cos(theta) merge
+    Key key = {p.x + 0.f, p.y + 0.f, p.z + 0.f, n.x + 0.f, n.y + 0.f, n.z + 0.f};
+
+    auto [it, inserted] = m_lookup.try_emplace(key, uint32_t(m_vertices.size() / 6));
+    if (inserted) {
+        m_vertices.insert(m_vertices.end(), key.begin(), key.end());
+    }
+    m_indices.push_back(it->second);
+}
+
+std::vector<float> MeshBuilder::expand() const {
+    std::vector<float> out;
+    out.reserve(m_indices.size() * 6);
+    for (uint32_t i : m_indices) {
+        const float *v = &m_vertices[size_t(i) * 6];
+        out.insert(out.end(), v, v + 6);
+    }
+    return out;
+}
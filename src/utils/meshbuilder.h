@@ -0,0 +1,36 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Collects triangle-list vertices for the primitives, merging vertices with an
+// identical position and normal so each is stored once and referenced by index.
+class MeshBuilder {
+public:
+    void clear();
+    // @param vertexCount unique vertices expected (sizes the merge table)
+    // @param cornerCount triangle corners about to be pushed
+    void reserve(size_t vertexCount, size_t cornerCount);
+
+    // Appends one triangle-list corner (three per triangle)
+    void push(const glm::vec3 &p, const glm::vec3 &n);
+
+    // Unique interleaved pos + normal vertices
+    const std::vector<float> &vertices() const { return m_vertices; }
+    const std::vector<uint32_t> &indices() const { return m_indices; }
+
+    // Fully expanded, non-indexed pos + normal triangle list
+    std::vector<float> expand() const;
+
+private:
+    using Key = std::array<float, 6>;
+    struct KeyHash {
+        size_t operator()(const Key &k) const;
+    };
+
+    std::vector<float> m_vertices;
+    std::vector<uint32_t> m_indices;
+    std::unordered_map<Key, uint32_t, KeyHash> m_lookup;
+};
@@ -0,0 +1,82 @@
+#include "offscreenrenderer.h"
+#include <mutex>
+
+bool OffscreenRenderer::initGL(std::string& error) {
+    // GLEW's function pointers are process-wide, so one initialisation covers
+    // every context. A GLX build of GLEW reports a missing GLX display when the
+    // context comes from EGL, after the GL entry points are already loaded.
+    static std::once_flag once;
+    static GLenum status;
+    std::call_once(once, [] { status = glewInit(); });
+    if (status == GLEW_OK || status == GLEW_ERROR_NO_GLX_DISPLAY) return true;
+    error = reinterpret_cast<const char*>(glewGetErrorString(status));
+    return false;
+}
+
+void OffscreenRenderer::init(int width, int height) {
+    m_width = width;
+    m_height = height;
+    m_renderer.init(width, height);
+    m_fbo = m_targets.acquireFramebuffer();
+    attachTargets();
+}
+
+void OffscreenRenderer::resize(int width, int height) {
+    if (width == m_width && height == m_height) return;
+    m_width = width;
+    m_height = height;
+    releaseTargets();
+    m_targets.trim();
+    attachTargets();
+    m_renderer.resize(width, height);
+}
+
+void OffscreenRenderer::destroy() {
+    releaseTargets();
+    m_targets.releaseFramebuffer(m_fbo);
+    m_fbo = 0;
+    m_targets.destroy();
+    m_renderer.destroy();
+}
+
+void OffscreenRenderer::attachTargets() {
+    // Depth is needed by forward+, which renders straight into the target without bloom
+    m_color = m_targets.acquireTexture(GL_RGBA8, m_width, m_height);
+    m_depth = m_targets.acquireTexture(GBuffer::DEPTH_FORMAT, m_width, m_height);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_color, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_depth, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void OffscreenRenderer::releaseTargets() {
+    m_targets.releaseTexture(m_color);
+    m_targets.releaseTexture(m_depth);
+    m_color = m_depth = 0;
+}
+
+void OffscreenRenderer::setScene(const RenderData& scene, int param1, int param2,
+                                 float nearPlane, float farPlane) {
+    m_renderer.setScene(scene, param1, param2);
+
+    // Same camera setup as Realtime::applyScene()
+    m_camPos = glm::vec3(scene.cameraData.pos);
+    glm::vec3 look = glm::vec3(scene.cameraData.look);
+    m_camera.setViewMatrix(m_camPos, glm::normalize(look - m_camPos), glm::normalize(glm::vec3(scene.cameraData.up)));
+    m_camera.setProjectionMatrix(float(m_width) / float(m_height), nearPlane, farPlane,
+                                 scene.cameraData.heightAngle);
+}
+
+void OffscreenRenderer::render() {
+    m_renderer.render(m_camera.getViewMatrix(), m_camera.getProjMatrix(), m_camPos, m_fbo);
+}
+
+QImage OffscreenRenderer::readback() {
+    QImage image(m_width, m_height, QImage::Format_RGBA8888);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, image.bits());
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // GL rows start at the bottom
+    return image.mirrored();
+}
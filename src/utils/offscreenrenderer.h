@@ -0,0 +1,46 @@
+#pragma once
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <QImage>
+#include <string>
+
+#include "camera.h"
+#include "scenerenderer.h"
+
+// A SceneRenderer plus the RGBA8 colour and depth target it draws into, with
+// the scene's own camera, for rendering without a window (batch_render, the
+// benchmarks and the image regression). Every call needs a current GL context;
+// each context needs its own OffscreenRenderer.
+class OffscreenRenderer {
+public:
+    // Loads the GL entry points once per process; call with a context current
+    static bool initGL(std::string& error);
+
+    void init(int width, int height);
+    void resize(int width, int height);
+    void destroy();
+
+    // Tessellates the scene and sets up its camera for the target's aspect ratio
+    void setScene(const RenderData& scene, int param1, int param2,
+                  float nearPlane = 0.1f, float farPlane = 100.f);
+    void render();
+    // The last render, top row first
+    QImage readback();
+
+    SceneRenderer& renderer() { return m_renderer; }
+    GLuint framebuffer() const { return m_fbo; }
+
+private:
+    SceneRenderer m_renderer;
+    RenderTargetPool m_targets;
+    GLuint m_fbo = 0, m_color = 0, m_depth = 0;
+    int m_width = 0, m_height = 0;
+
+    Camera m_camera;
+    glm::vec3 m_camPos;
+
+    void attachTargets();
+    void releaseTargets();
+};
@@ -1,147 +1,142 @@
 #include "postprocesspass.h"
-#include <iostream>
+#include "glstate.h"
+#include <algorithm>
 
-PostProcessPass::PostProcessPass()
-    : m_width(0), m_height(0) {}
+void PostProcessPass::init(RenderTargetPool* pool) {
+    m_pool = pool;
+    m_fbo = m_pool->acquireFramebuffer();
 
-PostProcessPass::~PostProcessPass() {
-    glDeleteFramebuffers(1, &m_extractFBO);
-    glDeleteTextures(1, &m_extractTex);
+    m_downsampleShader = std::make_unique<ShaderProgram>(
+        ":/resources/shaders/fullscreen_quad.vert",
+        ":/resources/shaders/bloom_downsample.frag");
 
-    glDeleteFramebuffers(1, &m_pingFBO);
-    glDeleteTextures(1, &m_pingTex);
-
-    glDeleteFramebuffers(1, &m_pongFBO);
-    glDeleteTextures(1, &m_pongTex);
-
-    glDeleteFramebuffers(1, &m_finalFBO);
-    glDeleteTextures(1, &m_finalTex);
-}
-
-void PostProcessPass::init(int w, int h) {
-    m_width = w;
-    m_height = h;
-
-    // Load shaders
-    m_extractShader = std::make_unique<ShaderProgram>(
-        "resources/shaders/bloom_extract.frag",
-        "resources/shaders/fullscreen_quad.vert");
-
-    m_blurHShader = std::make_unique<ShaderProgram>(
-        "resources/shaders/blur_h.frag",
-        "resources/shaders/fullscreen_quad.vert");
-
-    m_blurVShader = std::make_unique<ShaderProgram>(
-        "resources/shaders/blur_v.frag",
-        "resources/shaders/fullscreen_quad.vert");
+    m_upsampleShader = std::make_unique<ShaderProgram>(
+        ":/resources/shaders/fullscreen_quad.vert",
+        ":/resources/shaders/bloom_upsample.frag");
 
     m_compositeShader = std::make_unique<ShaderProgram>(
-        "resources/shaders/composite.frag",
-        "resources/shaders/fullscreen_quad.vert");
+        ":/resources/shaders/fullscreen_quad.vert",
+        ":/resources/shaders/composite.frag");
+
+    m_downsampleShader->use();
+    m_downsampleShader->setUniform1i("source", 0);
+    m_upsampleShader->use();
+    m_upsampleShader->setUniform1i("source", 0);
+    m_compositeShader->use();
+    m_compositeShader->setUniform1i("sceneTex", 0);
+    m_compositeShader->setUniform1i("bloomTex", 1);
+    GLState::current().useProgram(0);
 
-    initTextures();
-    initFBOs();
-}
+    m_downTexel = m_downsampleShader->uniform("texelSize");
+    m_upTexel = m_upsampleShader->uniform("texelSize");
+    m_strength = m_compositeShader->uniform("bloomStrength");
 
-void PostProcessPass::resize(int w, int h) {
-    m_width = w;
-    m_height = h;
-    initTextures();
-    initFBOs();
+    initQuad();
 }
 
-void PostProcessPass::initTextures() {
-    auto makeTex = [&](GLuint &tex) {
-        if (tex == 0) glGenTextures(1, &tex);
-        glBindTexture(GL_TEXTURE_2D, tex);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F,
-                     m_width, m_height, 0,
-                     GL_RGBA, GL_FLOAT, nullptr);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    };
-
-    makeTex(m_extractTex);
-    makeTex(m_pingTex);
-    makeTex(m_pongTex);
-    makeTex(m_finalTex);
+void PostProcessPass::destroy() {
+    m_pool->releaseFramebuffer(m_fbo);
+    m_fbo = 0;
+    glDeleteVertexArrays(1, &m_quadVAO);
+    glDeleteBuffers(1, &m_quadVBO);
+    m_downsampleShader.reset();
+    m_upsampleShader.reset();
+    m_compositeShader.reset();
 }
 
-void PostProcessPass::initFBOs() {
-    auto makeFBO = [&](GLuint &fbo, GLuint tex) {
-        if (fbo == 0) glGenFramebuffers(1, &fbo);
-        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-        glFramebufferTexture2D(GL_FRAMEBUFFER,
-                               GL_COLOR_ATTACHMENT0,
-                               GL_TEXTURE_2D, tex, 0);
-
-        GLenum att[1] = { GL_COLOR_ATTACHMENT0 };
-        glDrawBuffers(1, att);
-
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-            std::cerr << "[PostProcessPass] FBO incomplete!\n";
-        }
+void PostProcessPass::initQuad() {
+    GLState& gl = GLState::current();
+    float verts[] = {
+        -1.f, -1.f, 0.f, 0.f, 0.f,
+        1.f, -1.f, 0.f, 1.f, 0.f,
+        -1.f,  1.f, 0.f, 0.f, 1.f,
+        1.f,  1.f, 0.f, 1.f, 1.f
     };
 
-    makeFBO(m_extractFBO, m_extractTex);
-    makeFBO(m_pingFBO, m_pingTex);
-    makeFBO(m_pongFBO, m_pongTex);
-    makeFBO(m_finalFBO, m_finalTex);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-}
-
-void PostProcessPass::render(GLuint hdrColorTex) {
-    // ---- 1. Extract bright pixels ----
-    glBindFramebuffer(GL_FRAMEBUFFER, m_extractFBO);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    m_extractShader->bind();
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, hdrColorTex);
-    m_extractShader->setUniform1i("sceneTex", 0);
-
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    // ---- 2. Blur horizontally ----
-    glBindFramebuffer(GL_FRAMEBUFFER, m_pingFBO);
-    glClear(GL_COLOR_BUFFER_BIT);
+    glGenVertexArrays(1, &m_quadVAO);
+    glGenBuffers(1, &m_quadVBO);
 
-    m_blurHShader->bind();
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_extractTex);
-    m_blurHShader->setUniform1i("image", 0);
-    m_blurHShader->setUniform1f("texelSize", 1.0f / m_width);
+    gl.bindVertexArray(m_quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
 
-    // ---- 3. Blur vertically ----
-    glBindFramebuffer(GL_FRAMEBUFFER, m_pongFBO);
-    glClear(GL_COLOR_BUFFER_BIT);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5*sizeof(float), (void*)(3*sizeof(float)));
+    glEnableVertexAttribArray(1);
 
-    m_blurVShader->bind();
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, m_pingTex);
-    m_blurVShader->setUniform1i("image", 0);
-    m_blurVShader->setUniform1f("texelSize", 1.0f / m_height);
+    gl.bindVertexArray(0);
+}
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+void PostProcessPass::drawQuad() {
+    // Left bound: the next quad needs no rebind, and GLState unbinds it at frame end
+    GLState& gl = GLState::current();
+    gl.bindVertexArray(m_quadVAO);
+    gl.drawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
 
-    // ---- 4. Composite bloom + original scene ----
-    glBindFramebuffer(GL_FRAMEBUFFER, m_finalFBO);
-    glClear(GL_COLOR_BUFFER_BIT);
+std::vector<glm::ivec2> PostProcessPass::bloomLevels(int w, int h) {
+    std::vector<glm::ivec2> sizes;
+    glm::ivec2 size(w, h);
+    while (int(sizes.size()) < MAX_BLOOM_LEVELS) {
+        size = glm::max(size / 2, glm::ivec2(1));
+        sizes.push_back(size);
+        if (std::min(size.x, size.y) <= 8) break;
+    }
+    return sizes;
+}
 
-    m_compositeShader->bind();
+void PostProcessPass::bloom(GLuint brightTex, glm::ivec2 brightSize, const std::vector<GLuint>& levels,
+                            const std::vector<glm::ivec2>& sizes) {
+    GLState& gl = GLState::current();
+    gl.bindFramebuffer(m_fbo);
+    glDisable(GL_DEPTH_TEST);
+    gl.activeTexture(GL_TEXTURE0);
+
+    // Down: full-res bright-pass -> level 0 -> ... -> level n-1
+    m_downsampleShader->use();
+    GLuint source = brightTex;
+    glm::vec2 sourceTexel = 1.f / glm::vec2(brightSize);
+    for (size_t i = 0; i < levels.size(); i++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, levels[i], 0);
+        glViewport(0, 0, sizes[i].x, sizes[i].y);
+        gl.bindTexture(GL_TEXTURE_2D, source);
+        m_downsampleShader->set(m_downTexel, sourceTexel);
+        drawQuad();
+
+        source = levels[i];
+        sourceTexel = 1.f / glm::vec2(sizes[i]);
+    }
+
+    // Up: each level is tent-filtered and added onto the next larger one
+    m_upsampleShader->use();
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    for (size_t i = levels.size() - 1; i > 0; i--) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, levels[i - 1], 0);
+        glViewport(0, 0, sizes[i - 1].x, sizes[i - 1].y);
+        gl.bindTexture(GL_TEXTURE_2D, levels[i]);
+        m_upsampleShader->set(m_upTexel, 1.f / glm::vec2(sizes[i]));
+        drawQuad();
+    }
+    glDisable(GL_BLEND);
+
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+    gl.bindFramebuffer(0);
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, hdrColorTex);
-    m_compositeShader->setUniform1i("sceneTex", 0);
+void PostProcessPass::composite(GLuint hdrTex, GLuint bloomTex, float strength) {
+    GLState& gl = GLState::current();
+    glDisable(GL_DEPTH_TEST);
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, m_pongTex);
-    m_compositeShader->setUniform1i("bloomTex", 1);
+    m_compositeShader->use();
+    m_compositeShader->set(m_strength, strength);
 
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    gl.activeTexture(GL_TEXTURE0);
+    gl.bindTexture(GL_TEXTURE_2D, hdrTex);
+    gl.activeTexture(GL_TEXTURE1);
+    gl.bindTexture(GL_TEXTURE_2D, bloomTex);
 
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    drawQuad();
 }
@@ -5,42 +5,49 @@
 #endif
 
 #include <GL/glew.h>
+#include <glm/glm.hpp>
 #include <memory>
+#include <vector>
 #include "shaderprogram.h"
+#include "rendertargetpool.h"
 
+// Bloom and tone mapping. The lighting shaders write the bright-pass as a second
+// output, which bloom() filters down a pyramid starting at half resolution and
+// back up again; composite() adds the result to the HDR scene and tone maps it.
+// Targets are frame-graph transients passed in by the caller.
 class PostProcessPass {
 public:
-    PostProcessPass();
-    ~PostProcessPass();
-
-    void init(int w, int h);
-    void resize(int w, int h);
-
-    // Main entry point:
-    void render(GLuint hdrColorTex);
-
-    GLuint getOutputTexture() const { return m_finalTex; }
+    static constexpr GLenum HDR_FORMAT = GL_R11F_G11F_B10F;
+    // Luminance above which the lighting shaders feed bloom
+    static constexpr float BLOOM_THRESHOLD = 1.f;
+    static constexpr int MAX_BLOOM_LEVELS = 6;
+
+    // @param pool supplies the framebuffer the pyramid levels are attached to
+    void init(RenderTargetPool* pool);
+    void destroy();
+
+    // Size of each pyramid level for a w x h frame; level 0 is half resolution
+    static std::vector<glm::ivec2> bloomLevels(int w, int h);
+
+    // Leaves the bloom in levels[0]. Levels must match bloomLevels() and be
+    // linearly filtered.
+    // @param brightSize size of brightTex, i.e. the frame the levels were made for
+    void bloom(GLuint brightTex, glm::ivec2 brightSize, const std::vector<GLuint>& levels,
+               const std::vector<glm::ivec2>& sizes);
+    // Draws into the bound framebuffer, whose viewport the caller sets
+    void composite(GLuint hdrTex, GLuint bloomTex, float strength);
 
 private:
-    int m_width, m_height;
-
-    GLuint m_extractFBO = 0;
-    GLuint m_extractTex = 0;
+    RenderTargetPool* m_pool = nullptr;
+    GLuint m_fbo = 0;
+    GLuint m_quadVAO = 0, m_quadVBO = 0;
 
-    GLuint m_pingFBO = 0;
-    GLuint m_pingTex = 0;
-
-    GLuint m_pongFBO = 0;
-    GLuint m_pongTex = 0;
-
-    GLuint m_finalFBO = 0;
-    GLuint m_finalTex = 0;
-
-    std::unique_ptr<ShaderProgram> m_extractShader;
-    std::unique_ptr<ShaderProgram> m_blurHShader;
-    std::unique_ptr<ShaderProgram> m_blurVShader;
+    std::unique_ptr<ShaderProgram> m_downsampleShader;
+    std::unique_ptr<ShaderProgram> m_upsampleShader;
     std::unique_ptr<ShaderProgram> m_compositeShader;
 
-    void initTextures();
-    void initFBOs();
+    ShaderProgram::Uniform m_downTexel, m_upTexel, m_strength;
+
+    void initQuad();
+    void drawQuad();
 };
@@ -0,0 +1,37 @@
+#include "renderqueue.h"
+#include <algorithm>
+#include <cmath>
+
+uint64_t RenderQueue::makeKey(uint32_t pass, uint32_t shader, uint32_t vao, float depth, uint32_t material) {
+    constexpr uint32_t DEPTH_MAX = (1u << DEPTH_BITS) - 1;
+    uint32_t d = std::isnan(depth) ? DEPTH_MAX : uint32_t(std::clamp(depth, 0.f, 1.f) * DEPTH_MAX);
+    uint32_t m = std::min(material, (1u << MATERIAL_BITS) - 1);
+    return uint64_t(pass & 0xf) << 60 | uint64_t(shader & 0xff) << 52 | uint64_t(vao & 0xffff) << VAO_SHIFT |
+           uint64_t(d) << MATERIAL_BITS | m;
+}
+
+void RenderQueue::sort() {
+    if (m_items.size() < 2) return;
+
+    // All eight histograms in one read
+    uint32_t counts[8][256] = {};
+    for (const Item &item : m_items) {
+        for (int b = 0; b < 8; b++) counts[b][(item.key >> (8 * b)) & 0xff]++;
+    }
+
+    m_scratch.resize(m_items.size());
+    for (int b = 0; b < 8; b++) {
+        uint32_t *count = counts[b];
+        // Every key has the same byte here: the pass would only copy
+        if (count[(m_items[0].key >> (8 * b)) & 0xff] == m_items.size()) continue;
+
+        uint32_t offset = 0;
+        for (int i = 0; i < 256; i++) {
+            uint32_t c = count[i];
+            count[i] = offset;
+            offset += c;
+        }
+        for (const Item &item : m_items) m_scratch[count[(item.key >> (8 * b)) & 0xff]++] = item;
+        m_items.swap(m_scratch);
+    }
+}
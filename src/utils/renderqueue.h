@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Draw items ordered by a packed 64-bit key, rebuilt and sorted every frame.
+// From the most significant bits:
+//
+//   pass (4) | shader (8) | vao (16) | depth (24) | material (12)
+//
+// so items sharing render state end up adjacent and, within one vertex array,
+// run front to back for early-Z. Materials are looked up per instance from the
+// material table and cost no state change, so they only break ties.
+class RenderQueue {
+public:
+    struct Item {
+        uint64_t key;
+        uint32_t value; // caller's payload, e.g. an instance index
+    };
+
+    // @param depth view depth normalised to [0, 1]; clamped, NaN sorts last
+    // Wider fields are truncated to their bits (material saturates)
+    static uint64_t makeKey(uint32_t pass, uint32_t shader, uint32_t vao, float depth, uint32_t material);
+    static uint32_t vao(uint64_t key) { return uint32_t(key >> VAO_SHIFT) & 0xffff; }
+
+    void clear() { m_items.clear(); }
+    void push(uint64_t key, uint32_t value) { m_items.push_back({key, value}); }
+    // Stable LSD radix sort by key, one byte per pass; bytes every key shares are skipped
+    void sort();
+
+    const std::vector<Item> &items() const { return m_items; }
+    size_t size() const { return m_items.size(); }
+
+private:
+    static constexpr int MATERIAL_BITS = 12;
+    static constexpr int DEPTH_BITS = 24;
+    static constexpr int VAO_SHIFT = MATERIAL_BITS + DEPTH_BITS;
+
+    std::vector<Item> m_items, m_scratch;
+};
@@ -0,0 +1,128 @@
+#include "rendertargetpool.h"
+#include "glstate.h"
+#include <algorithm>
+#include <iostream>
+
+struct FormatInfo {
+    GLenum internalFormat;
+    GLenum format;
+    GLenum type;
+    int bytesPerPixel;
+};
+
+// Render-target formats used in this project; storage needs a matching
+// format/type pair even though no data is uploaded
+static const FormatInfo FORMATS[] = {
+    {GL_RGBA8,              GL_RGBA,            GL_UNSIGNED_BYTE,  4},
+    {GL_RG16,               GL_RG,              GL_UNSIGNED_SHORT, 4},
+    {GL_RGBA16F,            GL_RGBA,            GL_FLOAT,          8},
+    {GL_R11F_G11F_B10F,     GL_RGB,             GL_FLOAT,          4},
+    {GL_RG32F,              GL_RG,              GL_FLOAT,          8},
+    {GL_DEPTH_COMPONENT24,  GL_DEPTH_COMPONENT, GL_UNSIGNED_INT,   4},
+};
+
+static const FormatInfo &formatInfo(GLenum internalFormat) {
+    for (const FormatInfo &f : FORMATS) {
+        if (f.internalFormat == internalFormat) return f;
+    }
+    std::cerr << "[RenderTargetPool] Unknown format 0x" << std::hex << internalFormat << std::dec << ", assuming RGBA8\n";
+    return FORMATS[0];
+}
+
+GLuint RenderTargetPool::acquireTexture(GLenum internalFormat, int w, int h, GLenum filter) {
+    GLState& gl = GLState::current();
+    auto it = std::find_if(m_textures.begin(), m_textures.end(), [&](const Texture &t) {
+        return !t.inUse && t.internalFormat == internalFormat && t.width == w && t.height == h;
+    });
+
+    GLuint tex;
+    if (it != m_textures.end()) {
+        it->inUse = true;
+        tex = it->id;
+        gl.bindTexture(GL_TEXTURE_2D, tex);
+    } else {
+        const FormatInfo &f = formatInfo(internalFormat);
+        glGenTextures(1, &tex);
+        gl.bindTexture(GL_TEXTURE_2D, tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, f.format, f.type, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        m_textures.push_back({tex, internalFormat, w, h, true});
+        m_bytes += textureBytes(internalFormat, w, h);
+    }
+
+    // Filtering is per use, so it is reset even on a recycled texture
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    gl.bindTexture(GL_TEXTURE_2D, 0);
+    return tex;
+}
+
+void RenderTargetPool::releaseTexture(GLuint tex) {
+    for (Texture &t : m_textures) {
+        if (t.id == tex) {
+            t.inUse = false;
+            return;
+        }
+    }
+}
+
+GLuint RenderTargetPool::acquireFramebuffer() {
+    if (m_freeFramebuffers.empty()) {
+        GLuint fbo;
+        glGenFramebuffers(1, &fbo);
+        return fbo;
+    }
+    GLuint fbo = m_freeFramebuffers.back();
+    m_freeFramebuffers.pop_back();
+    return fbo;
+}
+
+void RenderTargetPool::releaseFramebuffer(GLuint fbo) {
+    GLState& gl = GLState::current();
+    if (fbo == 0) return;
+
+    // Detached so the next user does not inherit attachments it did not ask for
+    gl.bindFramebuffer(fbo);
+    for (GLenum attachment : {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2,
+                              GL_COLOR_ATTACHMENT3, GL_DEPTH_ATTACHMENT}) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, 0, 0);
+    }
+    gl.bindFramebuffer(0);
+
+    m_freeFramebuffers.push_back(fbo);
+}
+
+void RenderTargetPool::trim() {
+    auto unused = std::stable_partition(m_textures.begin(), m_textures.end(), [](const Texture &t) {
+        return t.inUse;
+    });
+    for (auto it = unused; it != m_textures.end(); ++it) {
+        glDeleteTextures(1, &it->id);
+        m_bytes -= textureBytes(it->internalFormat, it->width, it->height);
+    }
+    m_textures.erase(unused, m_textures.end());
+
+    if (!m_freeFramebuffers.empty()) {
+        glDeleteFramebuffers(GLsizei(m_freeFramebuffers.size()), m_freeFramebuffers.data());
+        m_freeFramebuffers.clear();
+    }
+}
+
+void RenderTargetPool::destroy() {
+    for (Texture &t : m_textures) t.inUse = false;
+    trim();
+}
+
+size_t RenderTargetPool::bytesInUse() const {
+    size_t bytes = 0;
+    for (const Texture &t : m_textures) {
+        if (t.inUse) bytes += textureBytes(t.internalFormat, t.width, t.height);
+    }
+    return bytes;
+}
+
+size_t RenderTargetPool::textureBytes(GLenum internalFormat, int w, int h) {
+    return size_t(w) * h * formatInfo(internalFormat).bytesPerPixel;
+}
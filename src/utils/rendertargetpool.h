@@ -0,0 +1,46 @@
+#pragma once
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <cstddef>
+#include <vector>
+
+// Recycles render-target textures and framebuffers so passes can reallocate on
+// resize without leaking. Textures are keyed by (internal format, size): a
+// released texture is handed out again for the same key, and trim() deletes
+// whatever is still unused, e.g. the old sizes after a resize.
+class RenderTargetPool {
+public:
+    // Nearest-filtered, edge-clamped 2D texture with storage for the key
+    GLuint acquireTexture(GLenum internalFormat, int w, int h, GLenum filter = GL_NEAREST);
+    void releaseTexture(GLuint tex);
+
+    // Framebuffers carry no storage; callers attach their own textures
+    GLuint acquireFramebuffer();
+    void releaseFramebuffer(GLuint fbo);
+
+    // Deletes every released texture and framebuffer
+    void trim();
+    void destroy();
+
+    // GPU memory held by pooled textures, in use or not
+    size_t bytesAllocated() const { return m_bytes; }
+    size_t bytesInUse() const;
+
+    // Storage size of one texture of the given key
+    static size_t textureBytes(GLenum internalFormat, int w, int h);
+
+private:
+    struct Texture {
+        GLuint id;
+        GLenum internalFormat;
+        int width;
+        int height;
+        bool inUse;
+    };
+
+    std::vector<Texture> m_textures;
+    std::vector<GLuint> m_freeFramebuffers;
+    size_t m_bytes = 0;
+};
@@ -0,0 +1,384 @@
+#include "scenebvh.h"
+#include "frustumculler.h"
+#include "tilelightgrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int SAH_BINS = 12;
+constexpr uint32_t MAX_LEAF_SIZE = 8;
+// Past this depth the build only splits at the median, which bounds the depth
+// of any tree over 2^32 items by SAH_MAX_DEPTH + 32 and the traversal stacks by MAX_DEPTH
+constexpr int SAH_MAX_DEPTH = 48;
+constexpr int MAX_DEPTH = 96;
+constexpr float INF = std::numeric_limits<float>::infinity();
+
+float surfaceArea(const glm::vec3& lo, const glm::vec3& hi) {
+    glm::vec3 d = glm::max(hi - lo, glm::vec3(0.f));
+    return 2.f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+bool isFinite(const glm::vec3& lo, const glm::vec3& hi) {
+    return std::isfinite(lo.x + lo.y + lo.z + hi.x + hi.y + hi.z);
+}
+
+// Entry and exit distances of the ray through the box, or false if it misses
+bool rayBox(const glm::vec3& origin, const glm::vec3& invDir, const glm::vec3& lo, const glm::vec3& hi,
+            float tMax, float& tEnter) {
+    glm::vec3 t0 = (lo - origin) * invDir, t1 = (hi - origin) * invDir;
+    glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+    float enter = std::max({tNear.x, tNear.y, tNear.z, 0.f});
+    float exit = std::min({tFar.x, tFar.y, tFar.z, tMax});
+    tEnter = enter;
+    return enter <= exit;
+}
+
+// Smallest root of a t^2 + b t + c above tMin whose hit point passes accept
+template <typename Accept>
+float quadric(float a, float b, float c, float tMin, const Accept& accept) {
+    if (std::abs(a) < 1e-12f) {
+        if (std::abs(b) < 1e-12f) return INF;
+        float t = -c / b;
+        return t > tMin && accept(t) ? t : INF;
+    }
+    float disc = b * b - 4.f * a * c;
+    if (disc < 0.f) return INF;
+    float s = std::sqrt(disc);
+    float t0 = (-b - s) / (2.f * a), t1 = (-b + s) / (2.f * a);
+    if (t0 > t1) std::swap(t0, t1);
+    if (t0 > tMin && accept(t0)) return t0;
+    if (t1 > tMin && accept(t1)) return t1;
+    return INF;
+}
+
+// Nearest hit of an object-space ray with a unit primitive, matching the
+// tessellated shapes: everything fits in [-0.5, 0.5]^3, round shapes have
+// radius 0.5 about the y axis and the cone's apex is at y = 0.5
+float intersectPrimitive(PrimitiveType type, const glm::vec3& o, const glm::vec3& d) {
+    constexpr float tMin = 1e-5f;
+    auto inY = [&](float t) { return std::abs(o.y + t * d.y) <= 0.5f; };
+    // Flat disk of radius 0.5 at height y
+    auto cap = [&](float y) {
+        if (std::abs(d.y) < 1e-12f) return INF;
+        float t = (y - o.y) / d.y;
+        float x = o.x + t * d.x, z = o.z + t * d.z;
+        return t > tMin && x * x + z * z <= 0.25f ? t : INF;
+    };
+
+    switch (type) {
+    case PrimitiveType::PRIMITIVE_CUBE: {
+        glm::vec3 inv = 1.f / d;
+        glm::vec3 t0 = (glm::vec3(-0.5f) - o) * inv, t1 = (glm::vec3(0.5f) - o) * inv;
+        glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+        float tEnter = std::max({tNear.x, tNear.y, tNear.z});
+        float tExit = std::min({tFar.x, tFar.y, tFar.z});
+        if (tEnter > tExit || tExit <= tMin) return INF;
+        return tEnter > tMin ? tEnter : tExit;
+    }
+    case PrimitiveType::PRIMITIVE_SPHERE:
+        return quadric(glm::dot(d, d), 2.f * glm::dot(o, d), glm::dot(o, o) - 0.25f, tMin,
+                       [](float) { return true; });
+    case PrimitiveType::PRIMITIVE_CYLINDER: {
+        float side = quadric(d.x * d.x + d.z * d.z, 2.f * (o.x * d.x + o.z * d.z),
+                             o.x * o.x + o.z * o.z - 0.25f, tMin, inY);
+        return std::min({side, cap(0.5f), cap(-0.5f)});
+    }
+    case PrimitiveType::PRIMITIVE_CONE: {
+        // x^2 + z^2 = k (0.5 - y)^2 with k = 0.25, written with h = 0.5 - o.y
+        const float k = 0.25f;
+        float h = 0.5f - o.y;
+        float side = quadric(d.x * d.x + d.z * d.z - k * d.y * d.y, 2.f * (o.x * d.x + o.z * d.z) + 2.f * k * h * d.y,
+                             o.x * o.x + o.z * o.z - k * h * h, tMin, inY);
+        return std::min(side, cap(-0.5f));
+    }
+    default:
+        return INF;
+    }
+}
+
+} // namespace
+
+void SceneBvh::Tree::build(const std::vector<Box>& boxes, const std::vector<uint32_t>& ids) {
+    m_items = ids;
+    m_nodes.clear();
+    m_nodes.reserve(2 * ids.size());
+    if (!ids.empty()) buildNode(boxes, 0, uint32_t(ids.size()), 0);
+}
+
+uint32_t SceneBvh::Tree::buildNode(const std::vector<Box>& boxes, uint32_t first, uint32_t count, int depth) {
+    uint32_t index = uint32_t(m_nodes.size());
+    m_nodes.push_back({});
+
+    glm::vec3 lo(INF), hi(-INF), cLo(INF), cHi(-INF);
+    for (uint32_t i = first; i < first + count; i++) {
+        const Box& b = boxes[m_items[i]];
+        lo = glm::min(lo, b.min);
+        hi = glm::max(hi, b.max);
+        glm::vec3 c = 0.5f * (b.min + b.max);
+        cLo = glm::min(cLo, c);
+        cHi = glm::max(cHi, c);
+    }
+    m_nodes[index].min = lo;
+    m_nodes[index].max = hi;
+
+    auto makeLeaf = [&] {
+        m_nodes[index].offset = first;
+        m_nodes[index].count = count;
+        return index;
+    };
+    if (count <= 2) return makeLeaf();
+
+    glm::vec3 extent = cHi - cLo;
+    int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+    if (extent[axis] <= 0.f && count <= MAX_LEAF_SIZE) return makeLeaf();
+
+    // Binned SAH: bin centroids along the widest axis, then sweep the 11 splits
+    uint32_t mid = first;
+    if (extent[axis] > 0.f && depth < SAH_MAX_DEPTH) {
+        struct Bin {
+            glm::vec3 lo{INF}, hi{-INF};
+            uint32_t count = 0;
+        } bins[SAH_BINS];
+        float scale = SAH_BINS / extent[axis];
+        auto binOf = [&](uint32_t id) {
+            float c = 0.5f * (boxes[id].min[axis] + boxes[id].max[axis]);
+            return std::min(int((c - cLo[axis]) * scale), SAH_BINS - 1);
+        };
+        for (uint32_t i = first; i < first + count; i++) {
+            Bin& bin = bins[binOf(m_items[i])];
+            bin.lo = glm::min(bin.lo, boxes[m_items[i]].min);
+            bin.hi = glm::max(bin.hi, boxes[m_items[i]].max);
+            bin.count++;
+        }
+
+        float leftArea[SAH_BINS - 1];
+        uint32_t leftCount[SAH_BINS - 1];
+        glm::vec3 bLo(INF), bHi(-INF);
+        uint32_t n = 0;
+        for (int i = 0; i < SAH_BINS - 1; i++) {
+            bLo = glm::min(bLo, bins[i].lo);
+            bHi = glm::max(bHi, bins[i].hi);
+            n += bins[i].count;
+            leftArea[i] = n ? surfaceArea(bLo, bHi) : 0.f;
+            leftCount[i] = n;
+        }
+        float bestCost = INF;
+        int bestSplit = 0;
+        bLo = glm::vec3(INF), bHi = glm::vec3(-INF);
+        n = 0;
+        for (int i = SAH_BINS - 1; i > 0; i--) {
+            bLo = glm::min(bLo, bins[i].lo);
+            bHi = glm::max(bHi, bins[i].hi);
+            n += bins[i].count;
+            float cost = leftCount[i - 1] * leftArea[i - 1] + n * (n ? surfaceArea(bLo, bHi) : 0.f);
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestSplit = i;
+            }
+        }
+
+        // A split pays one traversal step, costed like one primitive test
+        float leafCost = count * surfaceArea(lo, hi);
+        if (bestCost >= leafCost - surfaceArea(lo, hi) && count <= MAX_LEAF_SIZE) return makeLeaf();
+
+        mid = uint32_t(std::partition(m_items.begin() + first, m_items.begin() + first + count,
+                                      [&](uint32_t id) { return binOf(id) < bestSplit; }) - m_items.begin());
+    }
+    // SAH skipped (too deep, coincident centroids) or everything in one bin: median split
+    if (mid == first || mid == first + count) {
+        mid = first + count / 2;
+        std::nth_element(m_items.begin() + first, m_items.begin() + mid, m_items.begin() + first + count,
+                         [&](uint32_t a, uint32_t b) {
+            return boxes[a].min[axis] + boxes[a].max[axis] < boxes[b].min[axis] + boxes[b].max[axis];
+        });
+    }
+
+    buildNode(boxes, first, mid - first, depth + 1);
+    uint32_t right = buildNode(boxes, mid, first + count - mid, depth + 1);
+    m_nodes[index].offset = right;
+    m_nodes[index].count = 0;
+    return index;
+}
+
+void SceneBvh::Tree::refit(const std::vector<Box>& boxes) {
+    // Children always follow their parent, so a reverse sweep is bottom-up
+    for (size_t i = m_nodes.size(); i-- > 0;) {
+        Node& node = m_nodes[i];
+        if (node.count) {
+            node.min = glm::vec3(INF);
+            node.max = glm::vec3(-INF);
+            for (uint32_t k = node.offset; k < node.offset + node.count; k++) {
+                node.min = glm::min(node.min, boxes[m_items[k]].min);
+                node.max = glm::max(node.max, boxes[m_items[k]].max);
+            }
+        } else {
+            const Node& a = m_nodes[i + 1];
+            const Node& b = m_nodes[node.offset];
+            node.min = glm::min(a.min, b.min);
+            node.max = glm::max(a.max, b.max);
+        }
+    }
+}
+
+template <typename Test, typename Visit>
+void SceneBvh::Tree::traverse(const Test& test, const Visit& visit) const {
+    if (m_nodes.empty()) return;
+
+    // A node pushed as accepted skips its own and its descendants' tests
+    struct Entry {
+        uint32_t node;
+        bool accepted;
+    } stack[MAX_DEPTH];
+    int top = 0;
+    stack[top++] = {0, false};
+    while (top > 0) {
+        Entry e = stack[--top];
+        const Node& node = m_nodes[e.node];
+        bool accepted = e.accepted;
+        if (!accepted) {
+            int result = test(node.min, node.max);
+            if (result == 0) continue;
+            accepted = result == 2;
+        }
+        if (node.count) {
+            for (uint32_t k = node.offset; k < node.offset + node.count; k++) visit(m_items[k], accepted);
+        } else {
+            stack[top++] = {node.offset, accepted};
+            stack[top++] = {e.node + 1, accepted};
+        }
+    }
+}
+
+void SceneBvh::computeBounds(const RenderData& scene) {
+    m_shapeBoxes.resize(scene.shapes.size());
+    m_inverseCtm.resize(scene.shapes.size());
+    m_types.resize(scene.shapes.size());
+    for (size_t i = 0; i < scene.shapes.size(); i++) {
+        const RenderShapeData& s = scene.shapes[i];
+        shapeBounds(s.primitive, s.ctm, m_shapeBoxes[i].min, m_shapeBoxes[i].max);
+        m_inverseCtm[i] = glm::inverse(s.ctm);
+        m_types[i] = s.primitive.type;
+    }
+
+    m_lightBoxes.resize(scene.lights.size());
+    for (size_t i = 0; i < scene.lights.size(); i++) {
+        const SceneLightData& L = scene.lights[i];
+        float r = L.type == LightType::LIGHT_DIRECTIONAL ? INF : lightRange(L);
+        glm::vec3 c(L.pos);
+        m_lightBoxes[i] = {c - glm::vec3(r), c + glm::vec3(r)};
+    }
+}
+
+void SceneBvh::build(const RenderData& scene) {
+    computeBounds(scene);
+
+    auto split = [](const std::vector<Box>& boxes, std::vector<uint32_t>& unbounded) {
+        std::vector<uint32_t> bounded;
+        unbounded.clear();
+        for (uint32_t i = 0; i < boxes.size(); i++) {
+            (isFinite(boxes[i].min, boxes[i].max) ? bounded : unbounded).push_back(i);
+        }
+        return bounded;
+    };
+    m_shapeTree.build(m_shapeBoxes, split(m_shapeBoxes, m_unboundedShapes));
+    m_lightTree.build(m_lightBoxes, split(m_lightBoxes, m_unboundedLights));
+}
+
+void SceneBvh::refit(const RenderData& scene) {
+    computeBounds(scene);
+    m_shapeTree.refit(m_shapeBoxes);
+    m_lightTree.refit(m_lightBoxes);
+}
+
+void SceneBvh::queryFrustum(const glm::mat4& viewProj, std::vector<uint32_t>& shapes) const {
+    glm::vec4 planes[6];
+    frustumPlanes(viewProj, planes);
+
+    auto test = [&](const glm::vec3& lo, const glm::vec3& hi) {
+        glm::vec3 c = 0.5f * (lo + hi), e = 0.5f * (hi - lo);
+        bool inside = true;
+        for (const glm::vec4& p : planes) {
+            float d = glm::dot(glm::vec3(p), c) + p.w;
+            float r = glm::dot(glm::abs(glm::vec3(p)), e);
+            if (d + r < 0.f) return 0;
+            if (d - r < 0.f) inside = false;
+        }
+        return inside ? 2 : 1;
+    };
+
+    shapes = m_unboundedShapes;
+    m_shapeTree.traverse(test, [&](uint32_t id, bool accepted) {
+        if (accepted || test(m_shapeBoxes[id].min, m_shapeBoxes[id].max)) shapes.push_back(id);
+    });
+}
+
+void SceneBvh::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& shapes,
+                           std::vector<uint32_t>& lights) const {
+    float r2 = radius * radius;
+    auto overlaps = [&](const glm::vec3& lo, const glm::vec3& hi) {
+        glm::vec3 d = glm::clamp(center, lo, hi) - center;
+        return glm::dot(d, d) <= r2 ? 1 : 0;
+    };
+
+    shapes = m_unboundedShapes;
+    m_shapeTree.traverse(overlaps, [&](uint32_t id, bool) {
+        if (overlaps(m_shapeBoxes[id].min, m_shapeBoxes[id].max)) shapes.push_back(id);
+    });
+    lights = m_unboundedLights;
+    m_lightTree.traverse(overlaps, [&](uint32_t id, bool) {
+        if (overlaps(m_lightBoxes[id].min, m_lightBoxes[id].max)) lights.push_back(id);
+    });
+}
+
+bool SceneBvh::raycast(const glm::vec3& origin, const glm::vec3& dir, Hit& hit) const {
+    const std::vector<Tree::Node>& nodes = m_shapeTree.nodes();
+    const std::vector<uint32_t>& items = m_shapeTree.items();
+    hit = Hit();
+    if (nodes.empty()) return false;
+
+    glm::vec3 invDir = 1.f / dir;
+    uint32_t stack[MAX_DEPTH];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Tree::Node& node = nodes[stack[--top]];
+        float tEnter;
+        if (!rayBox(origin, invDir, node.min, node.max, hit.t, tEnter)) continue;
+
+        if (node.count) {
+            for (uint32_t k = node.offset; k < node.offset + node.count; k++) {
+                uint32_t id = items[k];
+                // The object-space direction is not normalised, so t carries over
+                const glm::mat4& inv = m_inverseCtm[id];
+                float t = intersectPrimitive(m_types[id], glm::vec3(inv * glm::vec4(origin, 1.f)),
+                                             glm::vec3(inv * glm::vec4(dir, 0.f)));
+                if (t < hit.t) {
+                    hit.shape = id;
+                    hit.t = t;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first so the farther one is more often pruned
+        uint32_t a = uint32_t(&node - nodes.data()) + 1, b = node.offset;
+        float ta, tb;
+        bool hitA = rayBox(origin, invDir, nodes[a].min, nodes[a].max, hit.t, ta);
+        bool hitB = rayBox(origin, invDir, nodes[b].min, nodes[b].max, hit.t, tb);
+        if (hitA && hitB) {
+            if (ta < tb) std::swap(a, b);
+            stack[top++] = a;
+            stack[top++] = b;
+        } else if (hitA) {
+            stack[top++] = a;
+        } else if (hitB) {
+            stack[top++] = b;
+        }
+    }
+
+    if (!std::isfinite(hit.t)) return false;
+    hit.position = origin + hit.t * dir;
+    return true;
+}
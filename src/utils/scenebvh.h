@@ -0,0 +1,84 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "sceneparser.h"
+
+// Bounding volume hierarchies over a scene's shapes and its lights' influence
+// spheres, for frustum queries, mouse picking and range queries. Items whose
+// extent is unbounded (meshes, directional lights, lights that never fall off)
+// are kept outside the trees and reported by every volume query.
+//
+// Queries only read the trees, so any number of threads may query at once;
+// build() and refit() must not overlap with queries.
+class SceneBvh {
+public:
+    struct Hit {
+        uint32_t shape = 0; // index into RenderData::shapes
+        float t = std::numeric_limits<float>::infinity(); // along the ray, in units of dir
+        glm::vec3 position{0.f};
+    };
+
+    // Builds both trees with the surface area heuristic
+    void build(const RenderData& scene);
+    // Recomputes bounds bottom-up after shapes' ctm or lights' positions changed,
+    // keeping the tree layout. The scene must have the same shapes and lights.
+    void refit(const RenderData& scene);
+
+    // Shapes whose bounds intersect viewProj's frustum
+    void queryFrustum(const glm::mat4& viewProj, std::vector<uint32_t>& shapes) const;
+    // Shapes and lights whose bounds overlap the sphere
+    void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& shapes,
+                     std::vector<uint32_t>& lights) const;
+    // Nearest shape hit by the ray, intersected with the analytic unit
+    // primitive under its ctm; meshes are never hit
+    bool raycast(const glm::vec3& origin, const glm::vec3& dir, Hit& hit) const;
+
+private:
+    struct Box {
+        glm::vec3 min, max;
+    };
+
+    // A flattened tree in depth-first order: an interior node's first child
+    // directly follows it, so only the second child's index is stored
+    class Tree {
+    public:
+        struct Node {
+            glm::vec3 min;
+            uint32_t offset; // leaf: first entry in items; interior: second child
+            glm::vec3 max;
+            uint32_t count;  // items in a leaf, 0 for interior nodes
+        };
+
+        void build(const std::vector<Box>& boxes, const std::vector<uint32_t>& ids);
+        void refit(const std::vector<Box>& boxes);
+
+        // Calls visit(id, accepted) for every item in a leaf whose node passes
+        // test(min, max), which returns 0 (reject), 1 (overlap) or 2 (accept the
+        // whole subtree; its items are visited with accepted set)
+        template <typename Test, typename Visit>
+        void traverse(const Test& test, const Visit& visit) const;
+
+        const std::vector<Node>& nodes() const { return m_nodes; }
+        const std::vector<uint32_t>& items() const { return m_items; }
+
+    private:
+        std::vector<Node> m_nodes;
+        std::vector<uint32_t> m_items; // ids, grouped by leaf
+
+        uint32_t buildNode(const std::vector<Box>& boxes, uint32_t first, uint32_t count, int depth);
+    };
+
+    Tree m_shapeTree, m_lightTree;
+    std::vector<Box> m_shapeBoxes, m_lightBoxes;
+    std::vector<uint32_t> m_unboundedShapes, m_unboundedLights;
+
+    // Per shape, for taking rays into object space
+    std::vector<glm::mat4> m_inverseCtm;
+    std::vector<PrimitiveType> m_types;
+
+    void computeBounds(const RenderData& scene);
+};
@@ -0,0 +1,304 @@
+#include "scenecache.h"
+
+#include <cstring>
+#include <iostream>
+#include <type_traits>
+#include <unordered_map>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+constexpr char MAGIC[8] = {'R', 'T', 'S', 'C', 'E', 'N', 'E', '\0'};
+constexpr uint32_t VERSION = 2;
+
+static_assert(std::is_trivially_copyable_v<SceneGlobalData>);
+static_assert(std::is_trivially_copyable_v<SceneCameraData>);
+static_assert(std::is_trivially_copyable_v<SceneLightData>);
+
+struct StringRef {
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct CachedFileMap {
+    uint32_t isUsed;
+    float repeatU;
+    float repeatV;
+    StringRef filename;
+};
+
+// SceneMaterial with its strings moved into the string table
+struct CachedMaterial {
+    SceneColor cAmbient;
+    SceneColor cDiffuse;
+    SceneColor cSpecular;
+    float shininess;
+    SceneColor cReflective;
+    SceneColor cTransparent;
+    float ior;
+    CachedFileMap textureMap;
+    float blend;
+    SceneColor cEmissive;
+    CachedFileMap bumpMap;
+};
+
+struct CachedShape {
+    glm::mat4 ctm;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    uint32_t type;
+    uint32_t material; // index into the interned material array
+    StringRef meshfile;
+};
+
+// File layout: Header, CachedMaterial[], SceneLightData[], CachedShape[], string bytes
+struct Header {
+    char magic[8];
+    uint32_t version;
+    // Struct sizes of the build that wrote the cache
+    uint32_t materialSize;
+    uint32_t lightSize;
+    uint32_t shapeSize;
+    SceneCache::SourceStamp source;
+    SceneGlobalData globalData;
+    SceneCameraData cameraData;
+    uint32_t materialCount;
+    uint32_t lightCount;
+    uint32_t shapeCount;
+    uint32_t stringBytes;
+};
+
+class StringTable {
+public:
+    StringRef add(const std::string &s) {
+        if (s.empty()) return {0, 0};
+        StringRef ref{uint32_t(bytes.size()), uint32_t(s.size())};
+        bytes += s;
+        return ref;
+    }
+    std::string bytes;
+};
+
+static std::string readString(const char *strings, uint32_t stringBytes, const StringRef &ref) {
+    if (ref.length == 0 || uint64_t(ref.offset) + ref.length > stringBytes) return std::string();
+    return std::string(strings + ref.offset, ref.length);
+}
+
+static CachedFileMap packFileMap(const SceneFileMap &map, StringTable &strings) {
+    CachedFileMap out;
+    std::memset(&out, 0, sizeof(out));
+    out.isUsed = map.isUsed;
+    out.repeatU = map.repeatU;
+    out.repeatV = map.repeatV;
+    out.filename = strings.add(map.filename);
+    return out;
+}
+
+static void unpackFileMap(const CachedFileMap &in, const char *strings, uint32_t stringBytes, SceneFileMap &out) {
+    out.isUsed = in.isUsed != 0;
+    out.repeatU = in.repeatU;
+    out.repeatV = in.repeatV;
+    out.filename = readString(strings, stringBytes, in.filename);
+}
+
+static uint64_t fnv1a(const uchar *data, int64_t size) {
+    uint64_t h = 1469598103934665603ull;
+    for (int64_t i = 0; i < size; i++) {
+        h ^= data[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+} // namespace
+
+std::string SceneCache::cachePath(const std::string &scenePath) {
+    QString dir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+    if (dir.isEmpty()) return std::string();
+    dir += "/realtime/scenes";
+    if (!QDir().mkpath(dir)) return std::string();
+
+    // One file per source path; the stamp inside tells versions of it apart
+    QByteArray path = QFileInfo(QString::fromStdString(scenePath)).absoluteFilePath().toUtf8();
+    uint64_t key = fnv1a(reinterpret_cast<const uchar *>(path.constData()), path.size());
+    return (dir + "/" + QString::number(key, 16).rightJustified(16, '0') + ".cache").toStdString();
+}
+
+bool SceneCache::stamp(const std::string &scenePath, SourceStamp &out) {
+    QString path = QString::fromStdString(scenePath);
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly)) return false;
+
+    out.mtime = QFileInfo(path).lastModified().toMSecsSinceEpoch();
+    out.size = file.size();
+    out.hash = fnv1a(nullptr, 0);
+    if (out.size > 0) {
+        uchar *data = file.map(0, out.size);
+        if (!data) return false;
+        out.hash = fnv1a(data, out.size);
+        file.unmap(data);
+    }
+    return true;
+}
+
+bool SceneCache::load(const std::string &scenePath, const SourceStamp &source, RenderData &renderData) {
+    std::string path = cachePath(scenePath);
+    if (path.empty()) return false;
+    QFile file(QString::fromStdString(path));
+    if (!file.exists() || !file.open(QFile::ReadOnly)) return false;
+
+    const int64_t fileSize = file.size();
+    if (fileSize < int64_t(sizeof(Header))) return false;
+
+    const uchar *data = file.map(0, fileSize);
+    if (!data) return false;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+
+    bool valid = std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+                 && header.version == VERSION
+                 && header.materialSize == sizeof(CachedMaterial)
+                 && header.lightSize == sizeof(SceneLightData)
+                 && header.shapeSize == sizeof(CachedShape)
+                 && header.source.mtime == source.mtime
+                 && header.source.size == source.size
+                 && header.source.hash == source.hash;
+
+    const uint64_t materialsOffset = sizeof(Header);
+    const uint64_t lightsOffset = materialsOffset + uint64_t(header.materialCount) * sizeof(CachedMaterial);
+    const uint64_t shapesOffset = lightsOffset + uint64_t(header.lightCount) * sizeof(SceneLightData);
+    const uint64_t stringsOffset = shapesOffset + uint64_t(header.shapeCount) * sizeof(CachedShape);
+    valid = valid && stringsOffset + header.stringBytes == uint64_t(fileSize);
+
+    if (!valid) {
+        file.unmap(const_cast<uchar *>(data));
+        return false;
+    }
+
+    const char *strings = reinterpret_cast<const char *>(data + stringsOffset);
+
+    renderData.globalData = header.globalData;
+    renderData.cameraData = header.cameraData;
+
+    renderData.lights.resize(header.lightCount);
+    std::memcpy(renderData.lights.data(), data + lightsOffset, header.lightCount * sizeof(SceneLightData));
+
+    std::vector<SceneMaterial> materials(header.materialCount);
+    for (uint32_t i = 0; i < header.materialCount; i++) {
+        CachedMaterial cm;
+        std::memcpy(&cm, data + materialsOffset + i * sizeof(CachedMaterial), sizeof(CachedMaterial));
+
+        SceneMaterial &m = materials[i];
+        m.cAmbient = cm.cAmbient;
+        m.cDiffuse = cm.cDiffuse;
+        m.cSpecular = cm.cSpecular;
+        m.shininess = cm.shininess;
+        m.cReflective = cm.cReflective;
+        m.cTransparent = cm.cTransparent;
+        m.ior = cm.ior;
+        unpackFileMap(cm.textureMap, strings, header.stringBytes, m.textureMap);
+        m.blend = cm.blend;
+        m.cEmissive = cm.cEmissive;
+        unpackFileMap(cm.bumpMap, strings, header.stringBytes, m.bumpMap);
+    }
+
+    renderData.shapes.resize(header.shapeCount);
+    for (uint32_t i = 0; i < header.shapeCount; i++) {
+        CachedShape cs;
+        std::memcpy(&cs, data + shapesOffset + i * sizeof(CachedShape), sizeof(CachedShape));
+
+        RenderShapeData &rs = renderData.shapes[i];
+        rs.ctm = cs.ctm;
+        rs.boundsMin = cs.boundsMin;
+        rs.boundsMax = cs.boundsMax;
+        rs.primitive.type = PrimitiveType(cs.type);
+        rs.primitive.material = cs.material < materials.size() ? materials[cs.material] : SceneMaterial{};
+        rs.primitive.meshfile = readString(strings, header.stringBytes, cs.meshfile);
+    }
+
+    file.unmap(const_cast<uchar *>(data));
+    return true;
+}
+
+bool SceneCache::store(const std::string &scenePath, const SourceStamp &source, const RenderData &renderData) {
+    StringTable strings;
+
+    // Intern materials by their packed bytes; most scenes reuse a handful
+    std::vector<CachedMaterial> materials;
+    std::unordered_map<std::string, uint32_t> materialLookup;
+
+    std::vector<CachedShape> shapes(renderData.shapes.size());
+    for (size_t i = 0; i < renderData.shapes.size(); i++) {
+        const RenderShapeData &rs = renderData.shapes[i];
+        const SceneMaterial &m = rs.primitive.material;
+
+        StringTable materialStrings;
+        CachedMaterial cm;
+        std::memset(&cm, 0, sizeof(cm));
+        cm.cAmbient = m.cAmbient;
+        cm.cDiffuse = m.cDiffuse;
+        cm.cSpecular = m.cSpecular;
+        cm.shininess = m.shininess;
+        cm.cReflective = m.cReflective;
+        cm.cTransparent = m.cTransparent;
+        cm.ior = m.ior;
+        cm.textureMap = packFileMap(m.textureMap, materialStrings);
+        cm.blend = m.blend;
+        cm.cEmissive = m.cEmissive;
+        cm.bumpMap = packFileMap(m.bumpMap, materialStrings);
+
+        std::string key(reinterpret_cast<const char *>(&cm), sizeof(cm));
+        key += materialStrings.bytes;
+
+        auto [it, inserted] = materialLookup.try_emplace(key, uint32_t(materials.size()));
+        if (inserted) {
+            // Re-point the strings into the shared table
+            cm.textureMap.filename = strings.add(m.textureMap.filename);
+            cm.bumpMap.filename = strings.add(m.bumpMap.filename);
+            materials.push_back(cm);
+        }
+
+        CachedShape &cs = shapes[i];
+        std::memset(&cs, 0, sizeof(cs));
+        cs.ctm = rs.ctm;
+        cs.boundsMin = rs.boundsMin;
+        cs.boundsMax = rs.boundsMax;
+        cs.type = uint32_t(rs.primitive.type);
+        cs.material = it->second;
+        cs.meshfile = strings.add(rs.primitive.meshfile);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.materialSize = sizeof(CachedMaterial);
+    header.lightSize = sizeof(SceneLightData);
+    header.shapeSize = sizeof(CachedShape);
+    header.source = source;
+    header.globalData = renderData.globalData;
+    header.cameraData = renderData.cameraData;
+    header.materialCount = materials.size();
+    header.lightCount = renderData.lights.size();
+    header.shapeCount = shapes.size();
+    header.stringBytes = strings.bytes.size();
+
+    std::string path = cachePath(scenePath);
+    if (path.empty()) return false;
+    // Written to a temporary file and renamed over the old cache on commit()
+    QSaveFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::WriteOnly)) {
+        std::cerr << "[SceneCache] Could not write cache for " << scenePath << "\n";
+        return false;
+    }
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(materials.data()), materials.size() * sizeof(CachedMaterial));
+    file.write(reinterpret_cast<const char *>(renderData.lights.data()), renderData.lights.size() * sizeof(SceneLightData));
+    file.write(reinterpret_cast<const char *>(shapes.data()), shapes.size() * sizeof(CachedShape));
+    file.write(strings.bytes.data(), strings.bytes.size());
+    return file.commit();
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "sceneparser.h"
+
+#include <cstdint>
+#include <string>
+
+// Flat binary copy of a parsed scene, kept in the per-user cache directory
+// (QStandardPaths::GenericCacheLocation) under a hash of the scene's absolute
+// path, so the source tree is never written to. A cache is only used when the
+// scene file's mtime, size and content hash still match, in which case it is
+// memory-mapped and copied straight into RenderData without touching the JSON
+// parser or building a scene graph. Caches are written to a temporary file and
+// renamed into place, so tools running in parallel never read a partial one.
+class SceneCache {
+public:
+    // Identifies one version of a scene file
+    struct SourceStamp {
+        int64_t mtime = 0; // ms since epoch
+        int64_t size = 0;
+        uint64_t hash = 0; // FNV-1a over the file contents
+    };
+
+    // Empty if there is no writable cache directory
+    static std::string cachePath(const std::string &scenePath);
+    static bool stamp(const std::string &scenePath, SourceStamp &out);
+
+    // @return false if there is no cache, or it is stale or unreadable
+    static bool load(const std::string &scenePath, const SourceStamp &source, RenderData &renderData);
+    static bool store(const std::string &scenePath, const SourceStamp &source, const RenderData &renderData);
+};
@@ -76,8 +76,10 @@ bool ScenefileReader::readJSON() {
 
     // Load the JSON document
     QByteArray fileContents = file.readAll();
+    if (cancelled()) return false;
     QJsonParseError jsonError;
     QJsonDocument doc = QJsonDocument::fromJson(fileContents, &jsonError);
+    if (cancelled()) return false;
     if (doc.isNull()) {
         std::cout << "could not parse " << file_name << std::endl;
         std::cout << "parse error at line " << jsonError.offset << ": "
@@ -133,6 +135,8 @@ bool ScenefileReader::readJSON() {
         }
     }
 
+    if (cancelled()) return false;
+
     // Parse the groups
     if (scenefile.contains("groups")) {
         if (!parseGroups(scenefile["groups"], m_root)) {
@@ -769,6 +773,7 @@ bool ScenefileReader::parseGroups(const QJsonValue &groups, SceneNode *parent) {
 
     QJsonArray groupsArray = groups.toArray();
     for (auto group : groupsArray) {
+        if (cancelled()) return false;
         if (!group.isObject()) {
             std::cout << "group items must be of type object" << std::endl;
             return false;
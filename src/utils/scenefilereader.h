@@ -2,6 +2,7 @@
 
 #include "scenedata.h"
 
+#include <atomic>
 #include <vector>
 #include <map>
 
@@ -20,6 +21,10 @@ public:
     // Parse the XML scene file. Returns false if scene is invalid.
     bool readJSON();
 
+    // readJSON() gives up, returning false, once *cancel is set. Checked
+    // between stages and groups; QJsonDocument's own parse runs to the end.
+    void setCancelFlag(const std::atomic<bool> *cancel) { m_cancel = cancel; }
+
     SceneGlobalData getGlobalData() const;
 
     SceneCameraData getCameraData() const;
@@ -47,4 +52,7 @@ private:
 
     SceneNode *m_root;
     std::vector<SceneNode *> m_nodes;
+
+    const std::atomic<bool> *m_cancel = nullptr;
+    bool cancelled() const { return m_cancel && *m_cancel; }
 };
@@ -0,0 +1,87 @@
+#include "sceneloader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+SceneLoader::~SceneLoader() {
+    cancel();
+}
+
+void SceneLoader::start(const std::string &filepath, int param1, int param2) {
+    cancel();
+
+    m_cancel = false;
+    m_loading = true;
+    m_worker = std::thread(&SceneLoader::run, this, filepath, param1, param2);
+}
+
+void SceneLoader::cancel() {
+    m_cancel = true;
+    if (m_worker.joinable()) m_worker.join();
+
+    // The worker is gone, so it is safe to drain from this side
+    std::unique_ptr<Event> stale;
+    while (m_queue.pop(stale)) {}
+    m_loading = false;
+}
+
+bool SceneLoader::poll(std::unique_ptr<Event> &out) {
+    if (!m_queue.pop(out)) return false;
+    if (out->type != Event::Type::Mesh) {
+        m_loading = false;
+        if (m_worker.joinable()) m_worker.join();
+    }
+    return true;
+}
+
+void SceneLoader::reportProgress(const std::string &stage, int percent) {
+    if (m_progress) m_progress(stage, percent);
+}
+
+void SceneLoader::emitEvent(std::unique_ptr<Event> event) {
+    // The render thread drains a bounded number of events per frame
+    while (!m_cancel && !m_queue.push(std::move(event))) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void SceneLoader::run(std::string filepath, int param1, int param2) {
+    reportProgress("Parsing", 0);
+
+    auto scene = std::make_unique<Event>();
+    scene->type = Event::Type::Scene;
+    if (!SceneParser::parse(filepath, scene->scene, &m_cancel)) {
+        // cancel() is joining this thread; it wants no event
+        if (m_cancel) return;
+        auto failed = std::make_unique<Event>();
+        failed->type = Event::Type::Failed;
+        reportProgress("Failed", 100);
+        emitEvent(std::move(failed));
+        return;
+    }
+    if (m_cancel) return;
+
+    // Every distinct primitive the scene needs at the requested tessellation
+    std::vector<TessellationKey> keys;
+    for (const RenderShapeData &s : scene->scene.shapes) {
+        if (s.primitive.type == PrimitiveType::PRIMITIVE_MESH) continue;
+        TessellationKey key = TessellationCache::makeKey(s.primitive.type, param1, param2);
+        if (std::find(keys.begin(), keys.end(), key) == keys.end()) keys.push_back(key);
+    }
+
+    reportProgress("Tessellating", 40);
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (m_cancel) return;
+
+        auto mesh = std::make_unique<Event>();
+        mesh->type = Event::Type::Mesh;
+        mesh->progress = 40 + int(55 * (i + 1) / keys.size());
+        mesh->key = keys[i];
+        TessellationCache::tessellate(keys[i], mesh->mesh);
+        emitEvent(std::move(mesh));
+    }
+
+    scene->progress = 100;
+    emitEvent(std::move(scene));
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "sceneparser.h"
+#include "spscqueue.h"
+#include "tessellationcache.h"
+
+// Parses a scene file and tessellates its primitives on a worker thread. Results
+// are handed to the render thread through a lock-free queue as a sequence of
+// Mesh events (ready for TessellationCache::adopt) followed by one Scene event.
+class SceneLoader {
+public:
+    struct Event {
+        enum class Type { Mesh, Scene, Failed };
+
+        Type type;
+        int progress = 0;          // percent of the whole load reached once this event is applied
+        TessellationKey key{};     // Mesh only
+        TessellationCache::Mesh mesh; // Mesh only; CPU data, not yet uploaded
+        RenderData scene;          // Scene only
+    };
+
+    // Called from the worker thread as well as the render thread
+    using ProgressCallback = std::function<void(const std::string &stage, int percent)>;
+
+    ~SceneLoader();
+
+    void setProgressCallback(ProgressCallback callback) { m_progress = std::move(callback); }
+
+    // Cancels any load in flight, then starts loading filepath
+    void start(const std::string &filepath, int param1, int param2);
+    // Waits for the worker, which stops at the next parse stage, group or mesh
+    void cancel();
+
+    // True from start() until the Scene or Failed event has been polled
+    bool isLoading() const { return m_loading; }
+
+    // Render thread only
+    bool poll(std::unique_ptr<Event> &out);
+    void reportProgress(const std::string &stage, int percent);
+
+private:
+    void run(std::string filepath, int param1, int param2);
+    void emitEvent(std::unique_ptr<Event> event);
+
+    std::thread m_worker;
+    std::atomic<bool> m_cancel{false};
+    bool m_loading = false;
+
+    SpscQueue<std::unique_ptr<Event>, 64> m_queue;
+    ProgressCallback m_progress;
+};
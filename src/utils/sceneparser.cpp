@@ -1,11 +1,13 @@
 // sceneparser.cpp
 #include "sceneparser.h"
 #include "scenefilereader.h"
+#include "scenecache.h"
 #include "scenedata.h"
 
 #include <glm/glm.hpp>
 #include <cmath>
 #include <iostream>
+#include <limits>
 
 // --- Small helpers to build CTMs from SceneTransformation ---
 namespace {
@@ -103,6 +105,7 @@ static void dfs(const SceneNode *node,
         RenderShapeData rs{};
         rs.primitive = *P; // copy material/primitive data
         rs.ctm       = M;
+        shapeBounds(*P, M, rs.boundsMin, rs.boundsMax);
         outShapes.push_back(rs);
     }
 
@@ -113,10 +116,47 @@ static void dfs(const SceneNode *node,
 }
 } // namespace
 
-bool SceneParser::parse(std::string filepath, RenderData &renderData) {
+void shapeBounds(const ScenePrimitive &primitive, const glm::mat4 &ctm, glm::vec3 &lo, glm::vec3 &hi) {
+    if (primitive.type == PrimitiveType::PRIMITIVE_MESH) {
+        lo = glm::vec3(-std::numeric_limits<float>::infinity());
+        hi = glm::vec3(std::numeric_limits<float>::infinity());
+        return;
+    }
+    // The unit primitives all fit in [-0.5, 0.5]^3; the box of that cube under
+    // ctm is centred on its translation with half extents |ctm3x3| * 0.5
+    glm::vec3 center(ctm[3]);
+    glm::vec3 extent = 0.5f * (glm::abs(glm::vec3(ctm[0])) + glm::abs(glm::vec3(ctm[1])) + glm::abs(glm::vec3(ctm[2])));
+    lo = center - extent;
+    hi = center + extent;
+}
+
+bool SceneParser::parse(std::string filepath, RenderData &renderData, const std::atomic<bool> *cancel) {
+    auto cancelled = [cancel] { return cancel && *cancel; };
+
+    // 0) Reuse the flattened binary cache if the scene file hasn't changed
+    SceneCache::SourceStamp stamp;
+    bool stamped = SceneCache::stamp(filepath, stamp);
+    if (cancelled()) return false;
+    if (stamped && SceneCache::load(filepath, stamp, renderData)) {
+        std::cout << "[SceneParser] Loaded " << renderData.shapes.size()
+                  << " shapes and " << renderData.lights.size() << " lights from cache\n";
+        return true;
+    }
+
+    if (!parseUncached(filepath, renderData, cancel)) return false;
+    if (stamped) {
+        SceneCache::store(filepath, stamp, renderData);
+    }
+    return true;
+}
+
+bool SceneParser::parseUncached(std::string filepath, RenderData &renderData, const std::atomic<bool> *cancel) {
+    auto cancelled = [cancel] { return cancel && *cancel; };
+
     ScenefileReader reader(filepath);
+    reader.setCancelFlag(cancel);
     if (!reader.readJSON()) {
-        std::cerr << "[SceneParser] Failed to read: " << filepath << "\n";
+        if (!cancelled()) std::cerr << "[SceneParser] Failed to read: " << filepath << "\n";
         return false;
     }
 
@@ -141,6 +181,7 @@ bool SceneParser::parse(std::string filepath, RenderData &renderData) {
     }
 
     dfs(root, glm::mat4(1.f), renderData.lights, renderData.shapes);
+    if (cancelled()) return false;
 
     std::cout << "[SceneParser] Successfully parsed " << renderData.shapes.size()
               << " shapes and " << renderData.lights.size() << " lights\n";
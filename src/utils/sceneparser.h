@@ -1,6 +1,7 @@
 #pragma once
 
 #include "utils/scenedata.h"
+#include <atomic>
 #include <vector>
 #include <string>
 
@@ -8,6 +9,10 @@
 struct RenderShapeData {
     ScenePrimitive primitive;
     glm::mat4 ctm; // the cumulative transformation matrix
+    // World-space box around the primitive; infinite for meshes, whose extent
+    // is not known until they are loaded
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
 };
 
 // Struct which contains all the data needed to render a scene
@@ -19,11 +24,18 @@ struct RenderData {
     std::vector<RenderShapeData> shapes;
 };
 
+// World-space box of a primitive under ctm, as stored in RenderShapeData
+void shapeBounds(const ScenePrimitive &primitive, const glm::mat4 &ctm, glm::vec3 &lo, glm::vec3 &hi);
+
 class SceneParser {
 public:
     // Parse the scene and store the results in renderData.
     // @param filepath    The path of the scene file to load.
     // @param renderData  On return, this will contain the metadata of the loaded scene.
+    // @param cancel      If given, the parse stops early and fails once it is set.
     // @return            A boolean value indicating whether the parse was successful.
-    static bool parse(std::string filepath, RenderData &renderData);
+    static bool parse(std::string filepath, RenderData &renderData, const std::atomic<bool> *cancel = nullptr);
+
+    // Same as parse, but always reads the JSON and neither reads nor writes SceneCache.
+    static bool parseUncached(std::string filepath, RenderData &renderData, const std::atomic<bool> *cancel = nullptr);
 };
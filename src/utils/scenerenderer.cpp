@@ -0,0 +1,420 @@
+#include "scenerenderer.h"
+#include "settings.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+
+void SceneRenderer::init(int width, int height) {
+    m_fbWidth = width;
+    m_fbHeight = height;
+    gbuffer.init(&m_renderTargets);
+    m_lightingFBO = m_renderTargets.acquireFramebuffer();
+    m_postProcess.init(&m_renderTargets);
+    deferred.init();
+    deferred.resize(m_fbWidth, m_fbHeight);
+    forward.init();
+    forward.resize(m_fbWidth, m_fbHeight);
+    m_materials.init();
+    m_frameUniforms.init();
+    m_profiler.init();
+    m_hiz.init();
+    m_hiz.resize(m_fbWidth, m_fbHeight);
+}
+
+void SceneRenderer::resize(int width, int height) {
+    m_fbWidth = width;
+    m_fbHeight = height;
+    // Last frame's targets went back to the pool; free the ones of the old size
+    m_renderTargets.trim();
+    deferred.resize(m_fbWidth, m_fbHeight);
+    forward.resize(m_fbWidth, m_fbHeight);
+    m_hiz.resize(m_fbWidth, m_fbHeight);
+}
+
+void SceneRenderer::destroy() {
+    cleanupVAOs();
+    m_hiz.destroy();
+    m_tessellation.destroy();
+    m_profiler.destroy();
+    m_frameUniforms.destroy();
+    m_materials.destroy();
+    forward.destroy();
+    deferred.destroy();
+    m_postProcess.destroy();
+    gbuffer.destroy();
+    m_renderTargets.releaseFramebuffer(m_lightingFBO);
+    m_lightingFBO = 0;
+    m_renderTargets.destroy();
+}
+
+void SceneRenderer::setScene(const RenderData& scene, int param1, int param2) {
+    m_shapes = scene.shapes;
+    m_param1 = param1;
+    m_param2 = param2;
+    deferred.setLights(scene.lights);
+    deferred.setGlobal(scene.globalData);
+    forward.setLights(scene.lights);
+    forward.setGlobal(scene.globalData);
+    generateShapeVAOs();
+    m_hiz.invalidate();
+    deferred.invalidateDepthBounds();
+}
+
+void SceneRenderer::rebuildShapes(int param1, int param2) {
+    m_param1 = param1;
+    m_param2 = param2;
+    generateShapeVAOs();
+    m_hiz.invalidate();
+    deferred.invalidateDepthBounds();
+}
+
+void SceneRenderer::render(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos, GLuint target) {
+    m_view = view;
+    m_proj = proj;
+    m_target = target;
+    m_stats = Stats();
+    // Qt and scene uploads rebind between frames, so tracking starts afresh
+    GLState& gl = GLState::current();
+    gl.beginFrame();
+    // Passes that shrink the viewport restore it to this; headless callers never set it
+    glViewport(0, 0, m_fbWidth, m_fbHeight);
+    m_hiz.update();
+    cullInstances(view, proj, camPos);
+
+    m_profiler.beginFrame();
+    {
+        GpuProfiler::Scope frame(&m_profiler, "frame");
+        m_frameUniforms.update(view, proj, camPos);
+        buildFrameGraph();
+        m_graph.execute(m_renderTargets, &m_profiler);
+    }
+    m_profiler.endFrame();
+    gl.endFrame();
+    m_glStats = gl.stats();
+    m_tileBoundsStale = settings.lightingPipeline == LightingPipeline::TiledDeferred && deferred.depthBoundsStale();
+}
+
+void SceneRenderer::buildFrameGraph() {
+    m_graph.reset();
+    FrameGraph::Resource backbuffer = m_graph.import("backbuffer", m_target);
+
+    // With bloom, lighting renders HDR colour plus its bright-pass off screen and
+    // the composite pass tone maps into the backbuffer
+    struct LightingData {
+        FrameGraph::Resource color = -1, bright = -1, depth = -1;
+    };
+    auto writeLighting = [&](LightingData& d, FrameGraph::PassBuilder& b) {
+        if (settings.bloom) {
+            d.color = b.create("hdr.color", {PostProcessPass::HDR_FORMAT, m_fbWidth, m_fbHeight});
+            d.bright = b.create("hdr.bright", {PostProcessPass::HDR_FORMAT, m_fbWidth, m_fbHeight, GL_LINEAR});
+        } else {
+            b.write(backbuffer);
+        }
+    };
+    auto lightingTarget = [this](const LightingData& d) -> GLuint {
+        if (d.color < 0) return m_target;
+        return bindLightingTarget(m_graph.texture(d.color), m_graph.texture(d.bright),
+                                  d.depth >= 0 ? m_graph.texture(d.depth) : 0);
+    };
+
+    const LightingData* lighting;
+    if (settings.lightingPipeline == LightingPipeline::ForwardPlus) {
+        lighting = &m_graph.addPass<LightingData>("forward+", [&](LightingData& d, FrameGraph::PassBuilder& b) {
+            writeLighting(d, b);
+            if (settings.bloom) d.depth = b.create("forward.depth", {GBuffer::DEPTH_FORMAT, m_fbWidth, m_fbHeight});
+        }, [this, lightingTarget](const LightingData& d) {
+            renderForwardPass(lightingTarget(d));
+        });
+        // Without bloom forward+ depth-tests in the backbuffer, which can't be sampled
+        if (lighting->depth >= 0) addHiZPass(lighting->depth);
+    } else {
+        struct GBufferData {
+            FrameGraph::Resource depth, normal, albedo, emissive = -1;
+        };
+        const GBufferData& g = m_graph.addPass<GBufferData>("geometry", [&](GBufferData& d, FrameGraph::PassBuilder& b) {
+            d.depth = b.create("gbuffer.depth", {GBuffer::DEPTH_FORMAT, m_fbWidth, m_fbHeight});
+            d.normal = b.create("gbuffer.normal", {GBuffer::NORMAL_FORMAT, m_fbWidth, m_fbHeight});
+            d.albedo = b.create("gbuffer.albedo", {GBuffer::ALBEDO_FORMAT, m_fbWidth, m_fbHeight});
+            if (m_sceneHasEmissive) {
+                d.emissive = b.create("gbuffer.emissive", {GBuffer::EMISSIVE_FORMAT, m_fbWidth, m_fbHeight});
+            }
+        }, [this](const GBufferData& d) {
+            gbuffer.attach(m_graph.texture(d.depth), m_graph.texture(d.normal), m_graph.texture(d.albedo),
+                           d.emissive >= 0 ? m_graph.texture(d.emissive) : 0);
+            renderGeometryPass();
+        });
+
+        bool tiled = settings.lightingPipeline == LightingPipeline::TiledDeferred;
+        lighting = &m_graph.addPass<LightingData>(tiled ? "tiled lighting" : "lighting", [&](LightingData& d, FrameGraph::PassBuilder& b) {
+            b.read(g.depth);
+            b.read(g.normal);
+            b.read(g.albedo);
+            if (g.emissive >= 0) b.read(g.emissive);
+            writeLighting(d, b);
+        }, [this, lightingTarget, tiled](const LightingData& d) {
+            GLuint target = lightingTarget(d);
+            if (tiled) {
+                deferred.renderTiled(&gbuffer, target, m_view, m_proj);
+            } else {
+                deferred.render(&gbuffer, target);
+            }
+        });
+        addHiZPass(g.depth);
+    }
+
+    if (!settings.bloom) return;
+
+    struct BloomData {
+        FrameGraph::Resource bright;
+        std::vector<FrameGraph::Resource> levels;
+        std::vector<glm::ivec2> sizes;
+    };
+    const BloomData& bloom = m_graph.addPass<BloomData>("bloom", [&](BloomData& d, FrameGraph::PassBuilder& b) {
+        d.bright = lighting->bright;
+        b.read(d.bright);
+        d.sizes = PostProcessPass::bloomLevels(m_fbWidth, m_fbHeight);
+        for (size_t i = 0; i < d.sizes.size(); i++) {
+            d.levels.push_back(b.create("bloom." + std::to_string(i),
+                                        {PostProcessPass::HDR_FORMAT, d.sizes[i].x, d.sizes[i].y, GL_LINEAR}));
+        }
+    }, [this](const BloomData& d) {
+        std::vector<GLuint> textures;
+        for (FrameGraph::Resource r : d.levels) textures.push_back(m_graph.texture(r));
+        m_postProcess.bloom(m_graph.texture(d.bright), glm::ivec2(m_fbWidth, m_fbHeight), textures, d.sizes);
+    });
+
+    struct CompositeData {
+        FrameGraph::Resource color, bloom;
+    };
+    m_graph.addPass<CompositeData>("composite", [&](CompositeData& d, FrameGraph::PassBuilder& b) {
+        d.color = lighting->color;
+        d.bloom = bloom.levels[0];
+        b.read(d.color);
+        b.read(d.bloom);
+        b.write(backbuffer);
+    }, [this](const CompositeData& d) {
+        GLState::current().bindFramebuffer(m_target);
+        glViewport(0, 0, m_fbWidth, m_fbHeight);
+        m_postProcess.composite(m_graph.texture(d.color), m_graph.texture(d.bloom), BLOOM_STRENGTH);
+    });
+}
+
+void SceneRenderer::addHiZPass(FrameGraph::Resource depth) {
+    if (!settings.occlusionCulling) return;
+    struct HiZData {
+        FrameGraph::Resource depth;
+    };
+    // Read back for culling later frames; nothing in this frame consumes it
+    m_graph.addPass<HiZData>("hi-z", [&](HiZData& d, FrameGraph::PassBuilder& b) {
+        d.depth = depth;
+        b.read(d.depth);
+        b.sideEffect();
+    }, [this](const HiZData& d) {
+        m_hiz.capture(m_graph.texture(d.depth), m_proj * m_view);
+    });
+}
+
+GLuint SceneRenderer::bindLightingTarget(GLuint color, GLuint bright, GLuint depth) {
+    GLState::current().bindFramebuffer(m_lightingFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, bright, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth, 0);
+
+    GLuint attachments[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, attachments);
+    return m_lightingFBO;
+}
+
+void SceneRenderer::generateShapeVAOs() {
+    GLState& gl = GLState::current();
+    // Keep the old meshes referenced until the new batches have acquired theirs,
+    // so primitives shared between the old and new layout are not re-tessellated
+    std::vector<TessellationKey> oldKeys;
+    for (auto &B : m_batches) oldKeys.push_back(B.key);
+    cleanupVAOs();
+
+    // Group shapes by (type, param1, param2) so each primitive is tessellated
+    // and uploaded once, with the CTM and material carried per instance
+    for (uint32_t i = 0; i < m_shapes.size(); i++) {
+        const RenderShapeData &s = m_shapes[i];
+        PrimitiveType type = s.primitive.type;
+        if (type == PrimitiveType::PRIMITIVE_MESH) continue;
+
+        TessellationKey key = TessellationCache::makeKey(type, m_param1, m_param2);
+
+        auto it = std::find_if(m_batches.begin(), m_batches.end(), [&](const ShapeBatch &b) {
+            return b.key == key;
+        });
+        if (it == m_batches.end()) {
+            ShapeBatch B{};
+            B.key = key;
+            m_batches.push_back(B);
+            it = m_batches.end() - 1;
+        }
+
+        it->instances.push_back({s.ctm, m_materials.intern(s.primitive.material)});
+        it->shapes.push_back(i);
+    }
+
+    std::vector<glm::vec3> mins, maxs;
+    for (auto &B : m_batches) {
+        for (uint32_t s : B.shapes) {
+            mins.push_back(m_shapes[s].boundsMin);
+            maxs.push_back(m_shapes[s].boundsMax);
+        }
+        B.visible.resize(B.instances.size());
+        std::iota(B.visible.begin(), B.visible.end(), 0u);
+    }
+    m_culler.setBoxes(mins, maxs);
+
+    m_materials.upload();
+    m_sceneHasEmissive = m_materials.hasEmissive();
+    m_renderTargets.trim();
+
+    for (auto &B : m_batches) {
+        const TessellationCache::Mesh &mesh = m_tessellation.acquire(B.key);
+        B.count = mesh.count;
+        B.indexType = mesh.indexType;
+
+        glGenVertexArrays(1, &B.vao);
+        glGenBuffers(1, &B.instanceVBO);
+
+        gl.bindVertexArray(B.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo); // recorded in the VAO
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6*sizeof(float), (void*)(3*sizeof(float)));
+        glEnableVertexAttribArray(1);
+
+        glBindBuffer(GL_ARRAY_BUFFER, B.instanceVBO);
+        // Rewritten with the visible subset whenever culling changes it
+        glBufferData(GL_ARRAY_BUFFER, B.instances.size() * sizeof(InstanceData), B.instances.data(), GL_DYNAMIC_DRAW);
+
+        // mat4 takes four consecutive vec4 attribute slots
+        for (int col = 0; col < 4; col++) {
+            glVertexAttribPointer(2 + col, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+                                  (void*)(offsetof(InstanceData, model) + col*sizeof(glm::vec4)));
+            glEnableVertexAttribArray(2 + col);
+            glVertexAttribDivisor(2 + col, 1);
+        }
+
+        glVertexAttribIPointer(6, 1, GL_INT, sizeof(InstanceData), (void*)offsetof(InstanceData, material));
+        glEnableVertexAttribArray(6);
+        glVertexAttribDivisor(6, 1);
+
+        gl.bindVertexArray(0);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    for (auto &key : oldKeys) m_tessellation.release(key);
+    m_tessellation.purgeUnused();
+}
+
+void SceneRenderer::drawBatches() {
+    GLState& gl = GLState::current();
+    // Camera matrices come from the FrameData block and materials from the
+    // table indexed per instance, so no uniforms are touched per batch
+    for (auto& B : m_batches) {
+        if (B.visible.empty()) continue;
+        gl.bindVertexArray(B.vao);
+        gl.drawElementsInstanced(GL_TRIANGLES, B.count, B.indexType, nullptr, B.visible.size());
+        m_stats.drawCalls++;
+        m_stats.triangles += int64_t(B.count / 3) * B.visible.size();
+    }
+}
+
+void SceneRenderer::cullInstances(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos) {
+    if (settings.frustumCulling) {
+        // NDC spans 2 units over the framebuffer height
+        float minRadius = settings.smallObjectCulling ? SMALL_OBJECT_PIXELS * 2.f / m_fbHeight : 0.f;
+        m_culler.cull(proj * view, proj, camPos, minRadius, m_boxVisible);
+    } else {
+        m_boxVisible.assign(m_culler.size(), 1);
+    }
+
+    // Against the depth of a frame already drawn, so a camera that moved since
+    // may briefly miss shapes that came out from behind others
+    bool occlusion = settings.occlusionCulling && m_hiz.ready();
+    // The far plane of a GL perspective matrix
+    float farPlane = proj[3][2] / (proj[2][2] + 1.f);
+
+    // Every shape is opaque and drawn by the same program, so keys order by
+    // batch, then front to back; unbounded shapes go last
+    m_queue.clear();
+    size_t box = 0;
+    for (uint32_t b = 0; b < m_batches.size(); b++) {
+        const ShapeBatch& B = m_batches[b];
+        for (uint32_t i = 0; i < B.instances.size(); i++) {
+            if (!m_boxVisible[box + i]) continue;
+            const RenderShapeData& shape = m_shapes[B.shapes[i]];
+            if (occlusion && !m_hiz.visible(shape.boundsMin, shape.boundsMax)) {
+                m_stats.occluded++;
+                continue;
+            }
+            glm::vec3 center = 0.5f * (shape.boundsMin + shape.boundsMax);
+            float depth = -(view * glm::vec4(center, 1.f)).z / farPlane;
+            m_queue.push(RenderQueue::makeKey(0, 0, b, depth, uint32_t(B.instances[i].material)), i);
+        }
+        box += B.instances.size();
+    }
+    m_queue.sort();
+
+    const std::vector<RenderQueue::Item>& items = m_queue.items();
+    size_t next = 0;
+    for (uint32_t b = 0; b < m_batches.size(); b++) {
+        ShapeBatch& B = m_batches[b];
+        m_visibleScratch.clear();
+        for (; next < items.size() && RenderQueue::vao(items[next].key) == b; next++) {
+            m_visibleScratch.push_back(items[next].value);
+        }
+        m_stats.instances += int(m_visibleScratch.size());
+        m_stats.culled += int(B.instances.size() - m_visibleScratch.size());
+
+        // A still camera re-uploads nothing; a moving one only when the
+        // visible set or its depth order changed
+        if (m_visibleScratch == B.visible) continue;
+        B.visible.swap(m_visibleScratch);
+
+        m_uploadScratch.clear();
+        for (uint32_t i : B.visible) m_uploadScratch.push_back(B.instances[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, B.instanceVBO);
+        GLState::current().bufferSubData(GL_ARRAY_BUFFER, 0, m_uploadScratch.size() * sizeof(InstanceData),
+                                         m_uploadScratch.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_occlusionStale = m_stats.occluded > 0 && m_hiz.viewProj() != proj * view;
+}
+
+void SceneRenderer::renderGeometryPass() {
+    gbuffer.bind();
+    glEnable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    deferred.shaderGeometry->use();
+    m_materials.bind(GL_TEXTURE0);
+    drawBatches();
+
+    gbuffer.unbind();
+}
+
+void SceneRenderer::renderForwardPass(GLuint target) {
+    GLState::current().bindFramebuffer(target);
+    glEnable(GL_DEPTH_TEST);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    forward.begin(m_view, m_proj, m_materials);
+    drawBatches();
+}
+
+void SceneRenderer::cleanupVAOs() {
+    for (auto& B : m_batches) {
+        glDeleteBuffers(1, &B.instanceVBO);
+        glDeleteVertexArrays(1, &B.vao);
+    }
+    m_batches.clear();
+    m_materials.clear();
+}
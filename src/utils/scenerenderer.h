@@ -0,0 +1,141 @@
+#pragma once
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "sceneparser.h"
+#include "gbuffer.h"
+#include "rendertargetpool.h"
+#include "framegraph.h"
+#include "gpuprofiler.h"
+#include "postprocesspass.h"
+#include "deferredrenderer.h"
+#include "forwardplusrenderer.h"
+#include "materialtable.h"
+#include "frameuniforms.h"
+#include "tessellationcache.h"
+#include "frustumculler.h"
+#include "glstate.h"
+#include "hizbuffer.h"
+#include "renderqueue.h"
+
+// Everything needed to draw a parsed scene into a framebuffer, independent of
+// any window: shape batches, materials, the render passes and their targets.
+// Realtime drives one from its QOpenGLWidget; the batch renderer drives one per
+// offscreen context. Lighting pipeline and bloom come from the global settings;
+// tessellation is passed in, so renderers on other threads can differ. Every
+// call needs the owning GL context to be current.
+class SceneRenderer {
+public:
+    // @param width, height framebuffer size in pixels
+    void init(int width, int height);
+    void resize(int width, int height);
+    void destroy();
+
+    // Copies the scene's shapes, lights and global data and tessellates its
+    // primitives with the given parameters; the camera is left to the caller
+    void setScene(const RenderData& scene, int param1, int param2);
+    // Rebuilds the shape batches with new tessellation parameters
+    void rebuildShapes(int param1, int param2);
+    // Lets meshes tessellated elsewhere (SceneLoader) be adopted before setScene()
+    TessellationCache& tessellation() { return m_tessellation; }
+
+    // Draws one frame into target, a framebuffer of the size passed to resize()
+    // with a depth attachment (0 for the default framebuffer)
+    void render(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos, GLuint target);
+
+    // Scene geometry submitted by the last render()
+    struct Stats {
+        int drawCalls = 0;
+        int64_t triangles = 0;
+        int instances = 0; // shapes drawn
+        int culled = 0;    // shapes skipped by culling
+        int occluded = 0;  // of those, skipped by occlusion culling
+    };
+    const Stats& stats() const { return m_stats; }
+    // GL calls made by the last render()
+    const GLState::Stats& glStats() const { return m_glStats; }
+    // Occlusion culling or tiled light culling used depth from an older camera
+    // than the last frame's (or none); draw again once newer depth is back
+    bool needsRefresh() const { return m_occlusionStale || m_tileBoundsStale; }
+
+    const FrameGraph& graph() const { return m_graph; }
+    const RenderTargetPool& renderTargets() const { return m_renderTargets; }
+    const GpuProfiler& profiler() const { return m_profiler; }
+    GpuProfiler& profiler() { return m_profiler; }
+
+    int width() const { return m_fbWidth; }
+    int height() const { return m_fbHeight; }
+
+private:
+    // Per-instance vertex attributes (divisor 1)
+    struct InstanceData {
+        glm::mat4 model;
+        GLint material; // index into m_materials
+    };
+
+    // All shapes sharing a tessellated primitive, drawn with one instanced call
+    struct ShapeBatch {
+        TessellationKey key;
+        GLuint vao;
+        GLuint instanceVBO;
+        int count;        // number of indices
+        GLenum indexType;
+        std::vector<InstanceData> instances;
+        std::vector<uint32_t> shapes;  // index into m_shapes per instance
+        std::vector<uint32_t> visible; // instances currently in instanceVBO, in order
+    };
+    std::vector<RenderShapeData> m_shapes;
+    int m_param1 = 1, m_param2 = 1;
+    std::vector<ShapeBatch> m_batches;
+    MaterialTable m_materials;
+    FrameUniforms m_frameUniforms;
+    TessellationCache m_tessellation;
+
+    // One box per batch instance, in batch order
+    FrustumCuller m_culler;
+    std::vector<uint8_t> m_boxVisible;
+    RenderQueue m_queue; // visible instances, value = index in its batch
+    std::vector<uint32_t> m_visibleScratch;
+    std::vector<InstanceData> m_uploadScratch;
+    static constexpr float SMALL_OBJECT_PIXELS = 1.f; // projected radius
+    HiZBuffer m_hiz;                // depth of a previous frame, for occlusion culling
+    bool m_occlusionStale = false;
+    bool m_tileBoundsStale = false; // tiled lighting ran without its depth bounds
+
+    // Shared by every pass that renders off screen
+    RenderTargetPool m_renderTargets;
+    FrameGraph m_graph;
+    GpuProfiler m_profiler;   // times every frame graph pass
+    int m_fbWidth = 0, m_fbHeight = 0;
+    bool m_sceneHasEmissive = false;
+    GBuffer gbuffer;
+    GLuint m_lightingFBO = 0; // HDR colour + bright-pass when bloom is on
+    PostProcessPass m_postProcess;
+    static constexpr float BLOOM_STRENGTH = 1.f;
+    DeferredRenderer deferred;
+    ForwardPlusRenderer forward;
+
+    // Valid during render()
+    glm::mat4 m_view, m_proj;
+    GLuint m_target = 0;
+    Stats m_stats;
+    GLState::Stats m_glStats;
+
+    void generateShapeVAOs();
+    void cleanupVAOs();
+    // Uploads each batch's visible instances front to back, if they changed since last frame
+    void cullInstances(const glm::mat4& view, const glm::mat4& proj, const glm::vec3& camPos);
+
+    void buildFrameGraph();
+    // Captures depth into m_hiz after it is written, when occlusion culling is on
+    void addHiZPass(FrameGraph::Resource depth);
+    void drawBatches();
+    void renderGeometryPass();
+    void renderForwardPass(GLuint target);
+    GLuint bindLightingTarget(GLuint color, GLuint bright, GLuint depth);
+};
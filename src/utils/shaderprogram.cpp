@@ -1,7 +1,10 @@
 #include "shaderprogram.h"
+#include "glstate.h"
 #include <QFile>
 #include <QString>
 #include <glm/glm.hpp>
+#include <cstring>
+#include <iostream>
 
 ShaderProgram::ShaderProgram() {
     id = glCreateProgram();
@@ -22,33 +25,151 @@ void ShaderProgram::attachShader(const std::string& path, GLenum type) {
     GLuint shader = glCreateShader(type);
     glShaderSource(shader, 1, &src, nullptr);
     glCompileShader(shader);
+
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status == GL_FALSE) {
+        GLint length;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string log(length, '\0');
+        glGetShaderInfoLog(shader, length, nullptr, &log[0]);
+        std::cerr << "[ShaderProgram] Failed to compile " << path << ":\n" << log << "\n";
+    }
+
     glAttachShader(id, shader);
 }
 
 void ShaderProgram::link() {
     glLinkProgram(id);
+
+    GLint status;
+    glGetProgramiv(id, GL_LINK_STATUS, &status);
+    if (status == GL_FALSE) {
+        GLint length;
+        glGetProgramiv(id, GL_INFO_LOG_LENGTH, &length);
+        std::string log(length, '\0');
+        glGetProgramInfoLog(id, length, nullptr, &log[0]);
+        std::cerr << "[ShaderProgram] Failed to link:\n" << log << "\n";
+        return;
+    }
+
+    m_slots.clear();
+    m_lookup.clear();
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> buf(maxLength + 1);
+    for (GLint i = 0; i < count; i++) {
+        GLint size;
+        GLenum type;
+        GLsizei length;
+        glGetActiveUniform(id, i, maxLength, &length, &size, &type, buf.data());
+        std::string name(buf.data(), length);
+
+        GLint location = glGetUniformLocation(id, name.c_str());
+        if (location < 0) continue; // block members have no location
+
+        // Arrays of basic types are reported once as "name[0]"; expose every element
+        if (size > 1 && name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+            std::string base = name.substr(0, name.size() - 3);
+            addSlot(base, location);
+            for (GLint e = 0; e < size; e++) {
+                std::string element = base + "[" + std::to_string(e) + "]";
+                addSlot(element, glGetUniformLocation(id, element.c_str()));
+            }
+        } else {
+            addSlot(name, location);
+        }
+    }
+}
+
+void ShaderProgram::addSlot(const std::string& name, GLint location) {
+    // Colliding names still get slots, found by comparing names in uniform()
+    auto [it, inserted] = m_lookup.try_emplace(uniformHash(name), int(m_slots.size()));
+    if (!inserted) it->second = -1;
+    Slot slot;
+    slot.name = name;
+    slot.location = location;
+    m_slots.push_back(slot);
 }
 
 void ShaderProgram::use() {
-    glUseProgram(id);
+    GLState::current().useProgram(id);
 }
 
 void ShaderProgram::bind() {
-    glUseProgram(id);
+    GLState::current().useProgram(id);
+}
+
+ShaderProgram::Uniform ShaderProgram::uniform(const std::string& name) const {
+    Uniform u;
+    auto it = m_lookup.find(uniformHash(name));
+    if (it == m_lookup.end()) return u;
+    if (it->second >= 0 && m_slots[it->second].name == name) {
+        u.m_slot = it->second;
+        return u;
+    }
+    // A hash collision, or a name the program lacks whose hash matches one it has
+    for (size_t i = 0; i < m_slots.size(); i++) {
+        if (m_slots[i].name == name) u.m_slot = int(i);
+    }
+    return u;
+}
+
+ShaderProgram::Uniform ShaderProgram::uniform(uint32_t nameHash) const {
+    Uniform u;
+    auto it = m_lookup.find(nameHash);
+    if (it != m_lookup.end()) u.m_slot = it->second;
+    return u;
+}
+
+bool ShaderProgram::changed(Uniform u, const void* data, size_t bytes) {
+    Slot& slot = m_slots[u.m_slot];
+    if (slot.uploaded && std::memcmp(slot.value, data, bytes) == 0) return false;
+    std::memcpy(slot.value, data, bytes);
+    slot.uploaded = true;
+    GLState::current().countUniformUpload();
+    return true;
+}
+
+void ShaderProgram::set(Uniform u, int v) {
+    if (u.valid() && changed(u, &v, sizeof(v))) glUniform1i(m_slots[u.m_slot].location, v);
+}
+
+void ShaderProgram::set(Uniform u, float v) {
+    if (u.valid() && changed(u, &v, sizeof(v))) glUniform1f(m_slots[u.m_slot].location, v);
+}
+
+void ShaderProgram::set(Uniform u, const glm::vec2& v) {
+    if (u.valid() && changed(u, &v[0], sizeof(v))) glUniform2f(m_slots[u.m_slot].location, v.x, v.y);
+}
+
+void ShaderProgram::set(Uniform u, const glm::vec3& v) {
+    if (u.valid() && changed(u, &v[0], sizeof(v))) glUniform3f(m_slots[u.m_slot].location, v.x, v.y, v.z);
+}
+
+void ShaderProgram::set(Uniform u, const glm::ivec3& v) {
+    if (u.valid() && changed(u, &v[0], sizeof(v))) glUniform3i(m_slots[u.m_slot].location, v.x, v.y, v.z);
+}
+
+void ShaderProgram::set(Uniform u, const glm::mat4& v) {
+    if (u.valid() && changed(u, &v[0][0], sizeof(v))) glUniformMatrix4fv(m_slots[u.m_slot].location, 1, GL_FALSE, &v[0][0]);
 }
 
 void ShaderProgram::setUniform1i(const std::string& name, int v) {
-    glUniform1i(glGetUniformLocation(id, name.c_str()), v);
+    set(uniform(name), v);
 }
 
 void ShaderProgram::setUniform1f(const std::string& name, float v) {
-    glUniform1f(glGetUniformLocation(id, name.c_str()), v);
+    set(uniform(name), v);
 }
 
 void ShaderProgram::setUniform3f(const std::string& name, const glm::vec3& v) {
-    glUniform3f(glGetUniformLocation(id, name.c_str()), v.x, v.y, v.z);
+    set(uniform(name), v);
 }
 
 void ShaderProgram::setUniform3f(const std::string& name, float x, float y, float z) {
-    glUniform3f(glGetUniformLocation(id, name.c_str()), x, y, z);
+    set(uniform(name), glm::vec3(x, y, z));
 }
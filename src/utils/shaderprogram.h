@@ -5,23 +5,75 @@
 
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// FNV-1a of a uniform name; constexpr so hot paths can resolve names at compile time
+constexpr uint32_t uniformHash(std::string_view name) {
+    uint32_t h = 2166136261u;
+    for (char c : name) {
+        h ^= uint8_t(c);
+        h *= 16777619u;
+    }
+    return h;
+}
 
 class ShaderProgram {
 public:
+    // Pre-resolved handle to an active uniform. Default-constructed or inactive
+    // handles are ignored by set(), like a -1 location would be.
+    class Uniform {
+    public:
+        bool valid() const { return m_slot >= 0; }
+    private:
+        friend class ShaderProgram;
+        int m_slot = -1;
+    };
+
     GLuint id;
 
     ShaderProgram();
     ShaderProgram(const std::string& vs, const std::string& fs);
 
     void attachShader(const std::string& path, GLenum type);
+    // Links and introspects every active uniform (glGetActiveUniform) into the lookup table
     void link();
     void use();
     void bind(); // compatibility alias
 
+    Uniform uniform(const std::string& name) const;
+    // Invalid for a hash two of the program's uniforms share; look those up by name
+    Uniform uniform(uint32_t nameHash) const;
+
+    // Upload to the program in use; skipped when the value matches the last upload
+    void set(Uniform u, int v);
+    void set(Uniform u, float v);
+    void set(Uniform u, const glm::vec2& v);
+    void set(Uniform u, const glm::vec3& v);
+    void set(Uniform u, const glm::ivec3& v);
+    void set(Uniform u, const glm::mat4& v);
+
     void setUniform1i(const std::string& name, int v);
     void setUniform1f(const std::string& name, float v);
 
     void setUniform3f(const std::string& name, const glm::vec3& v);
     void setUniform3f(const std::string& name, float x, float y, float z);
+
+private:
+    struct Slot {
+        std::string name;
+        GLint location;
+        bool uploaded = false;
+        float value[16]; // last uploaded value, compared bytewise
+    };
+
+    std::vector<Slot> m_slots;
+    std::unordered_map<uint32_t, int> m_lookup; // name hash -> slot, -1 if several names share it
+
+    void addSlot(const std::string& name, GLint location);
+    // @return false if the slot already holds these bytes
+    bool changed(Uniform u, const void* data, size_t bytes);
 };
@@ -3,15 +3,9 @@
 #include <algorithm>
 #include <cmath>
 
-static inline void pushPosNorm(std::vector<float>& dst,
-                               const glm::vec3& p,
-                               const glm::vec3& n) {
-    dst.push_back(p.x); dst.push_back(p.y); dst.push_back(p.z);
-    dst.push_back(n.x); dst.push_back(n.y); dst.push_back(n.z);
-}
 
 void Sphere::updateParams(int param1, int param2) {
-    m_vertexData.clear();
+    m_mesh.clear();
     // stacks must be at least 2 to avoid degenerate top/bottom bands
     m_param1 = std::max(2, param1);
     m_param2 = std::max(3, param2);
@@ -19,10 +13,12 @@ void Sphere::updateParams(int param1, int param2) {
 }
 
 void Sphere::setVertexData() {
-    m_vertexData.clear();
+    m_mesh.clear();
 
     const int stacks = m_param1;
     const int slices = m_param2;
+    // At most a ring per stack boundary; the poles collapse to fewer
+    m_mesh.reserve(size_t(stacks + 1) * (slices + 1), size_t(6) * stacks * slices);
 
     // phi ∈ [0, π], theta ∈ [0, 2π)
     const float dPhi   = glm::pi<float>() / stacks;
@@ -53,25 +49,25 @@ void Sphere::setVertexData() {
 
 
             // Upper tri
-            pushPosNorm(m_vertexData, TL, nTL);
-            pushPosNorm(m_vertexData, BL, nBL);
-            pushPosNorm(m_vertexData, BR, nBR);
+            m_mesh.push(TL, nTL);
+            m_mesh.push(BL, nBL);
+            m_mesh.push(BR, nBR);
             // Lower tri
-            pushPosNorm(m_vertexData, TL, nTL);
-            pushPosNorm(m_vertexData, BR, nBR);
-            pushPosNorm(m_vertexData, TR, nTR);
+            m_mesh.push(TL, nTL);
+            m_mesh.push(BR, nBR);
+            m_mesh.push(TR, nTR);
             // // Upper triangle (skip at north pole)
             // if (r0 > 0.f) {
-            //     pushPosNorm(m_vertexData, TL, nTL);
-            //     pushPosNorm(m_vertexData, BL, nBL);
-            //     pushPosNorm(m_vertexData, BR, nBR);
+            //     m_mesh.push(TL, nTL);
+            //     m_mesh.push(BL, nBL);
+            //     m_mesh.push(BR, nBR);
             // }
 
             // // Lower triangle (skip at south pole)
             // if (r1 > 0.f) {
-            //     pushPosNorm(m_vertexData, TL, nTL);
-            //     pushPosNorm(m_vertexData, BR, nBR);
-            //     pushPosNorm(m_vertexData, TR, nTR);
+            //     m_mesh.push(TL, nTL);
+            //     m_mesh.push(BR, nBR);
+            //     m_mesh.push(TR, nTR);
             // }
         }
     }
@@ -0,0 +1,136 @@
+#include "tessellationcache.h"
+#include "cube.h"
+#include "cone.h"
+#include "cylinder.h"
+#include "sphere.h"
+
+#include <algorithm>
+#include <iostream>
+
+size_t TessellationCache::KeyHash::operator()(const TessellationKey &k) const {
+    return (size_t(k.type) * 73856093u) ^ (size_t(k.param1) * 19349663u) ^ (size_t(k.param2) * 83492791u);
+}
+
+TessellationKey TessellationCache::makeKey(PrimitiveType type, int param1, int param2) {
+    switch (type) {
+    case PrimitiveType::PRIMITIVE_CUBE:
+        return {type, std::max(1, param1), 0};
+    case PrimitiveType::PRIMITIVE_SPHERE:
+        return {type, std::max(2, param1), std::max(3, param2)};
+    case PrimitiveType::PRIMITIVE_CYLINDER:
+    case PrimitiveType::PRIMITIVE_CONE:
+        return {type, std::max(1, param1), std::max(3, param2)};
+    default:
+        return {type, 0, 0};
+    }
+}
+
+template <typename Shape>
+static void copyIndexed(const Shape &shape, TessellationCache::Mesh &out) {
+    out.vertices = shape.getVertexData();
+    out.indices = shape.getIndexData();
+}
+
+void TessellationCache::tessellate(const TessellationKey &key, Mesh &out) {
+    switch (key.type) {
+    case PrimitiveType::PRIMITIVE_CUBE: {
+        Cube c;
+        c.updateParams(key.param1);  // ONLY 1 argument
+        copyIndexed(c, out);
+        break;
+    }
+    case PrimitiveType::PRIMITIVE_SPHERE: {
+        Sphere sph;
+        sph.updateParams(key.param1, key.param2);
+        copyIndexed(sph, out);
+        break;
+    }
+    case PrimitiveType::PRIMITIVE_CYLINDER: {
+        Cylinder cyl;
+        cyl.updateParams(key.param1, key.param2);
+        copyIndexed(cyl, out);
+        break;
+    }
+    case PrimitiveType::PRIMITIVE_CONE: {
+        Cone cn;
+        cn.updateParams(key.param1, key.param2);
+        copyIndexed(cn, out);
+        break;
+    }
+    default:
+        out.vertices.clear();
+        out.indices.clear();
+        break;
+    }
+    out.count = out.indices.size();
+}
+
+void TessellationCache::upload(Mesh &m) {
+    glGenBuffers(1, &m.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m.vbo);
+    glBufferData(GL_ARRAY_BUFFER, m.vertices.size() * sizeof(float), m.vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // Halve index memory whenever the vertex count allows it
+    glGenBuffers(1, &m.ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m.ebo);
+    if (m.vertices.size() / 6 <= 0xFFFF + 1) {
+        std::vector<uint16_t> shortIndices(m.indices.begin(), m.indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+        m.indexType = GL_UNSIGNED_SHORT;
+    } else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, m.indices.size() * sizeof(uint32_t), m.indices.data(), GL_STATIC_DRAW);
+        m.indexType = GL_UNSIGNED_INT;
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+const TessellationCache::Mesh &TessellationCache::acquire(const TessellationKey &key) {
+    Mesh &m = m_meshes[key];
+    if (m.vbo == 0) {
+        tessellate(key, m);
+        upload(m);
+    }
+    m.refCount++;
+    return m;
+}
+
+void TessellationCache::adopt(const TessellationKey &key, Mesh &&mesh) {
+    Mesh &m = m_meshes[key];
+    if (m.vbo == 0) {
+        int refCount = m.refCount;
+        m = std::move(mesh);
+        m.refCount = refCount;
+        upload(m);
+    }
+    m.refCount++;
+}
+
+void TessellationCache::release(const TessellationKey &key) {
+    auto it = m_meshes.find(key);
+    if (it == m_meshes.end() || it->second.refCount == 0) {
+        std::cerr << "[TessellationCache] Release of unreferenced mesh\n";
+        return;
+    }
+    it->second.refCount--;
+}
+
+void TessellationCache::purgeUnused() {
+    for (auto it = m_meshes.begin(); it != m_meshes.end();) {
+        if (it->second.refCount == 0) {
+            glDeleteBuffers(1, &it->second.ebo);
+            glDeleteBuffers(1, &it->second.vbo);
+            it = m_meshes.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void TessellationCache::destroy() {
+    for (auto &[key, m] : m_meshes) {
+        glDeleteBuffers(1, &m.ebo);
+        glDeleteBuffers(1, &m.vbo);
+    }
+    m_meshes.clear();
+}
@@ -0,0 +1,62 @@
+#pragma once
+#ifdef __APPLE__
+#define GL_SILENCE_DEPRECATION
+#endif
+#include <GL/glew.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "scenedata.h"
+
+// Identifies one tessellated unit primitive
+struct TessellationKey {
+    PrimitiveType type;
+    int param1;
+    int param2;
+
+    bool operator==(const TessellationKey &o) const {
+        return type == o.type && param1 == o.param1 && param2 == o.param2;
+    }
+};
+
+// Owns one CPU mesh and one GPU vertex buffer per (type, param1, param2), shared
+// by every shape that uses it. Meshes are reference-counted and survive across
+// scene/settings changes until purgeUnused() is called with no users left.
+class TessellationCache {
+public:
+    struct Mesh {
+        std::vector<float> vertices;   // unique interleaved pos + normal
+        std::vector<uint32_t> indices; // triangle list
+        GLuint vbo = 0;
+        GLuint ebo = 0;
+        int count = 0;                 // number of indices
+        GLenum indexType = GL_UNSIGNED_INT; // GL_UNSIGNED_SHORT when every index fits
+        int refCount = 0;
+    };
+
+    // Applies each primitive's own parameter clamping so equivalent settings share a key
+    static TessellationKey makeKey(PrimitiveType type, int param1, int param2);
+    // Fills the CPU side of a mesh (vertices and indices) without touching GL
+    static void tessellate(const TessellationKey &key, Mesh &out);
+
+    // Tessellates and uploads on a miss; must be called with a current GL context
+    const Mesh &acquire(const TessellationKey &key);
+    // Uploads a mesh tessellated elsewhere (e.g. by SceneLoader) unless one is
+    // already resident. Like acquire(), takes a reference the caller releases,
+    // so the mesh survives purgeUnused() until its scene has acquired it.
+    void adopt(const TessellationKey &key, Mesh &&mesh);
+    void release(const TessellationKey &key);
+
+    void purgeUnused();
+    void destroy();
+
+private:
+    static void upload(Mesh &m);
+
+    struct KeyHash {
+        size_t operator()(const TessellationKey &k) const;
+    };
+
+    std::unordered_map<TessellationKey, Mesh, KeyHash> m_meshes;
+};
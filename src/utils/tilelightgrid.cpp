@@ -0,0 +1,145 @@
+#include "tilelightgrid.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+float lightRange(const SceneLightData &light) {
+    // Solve intensity / (a + b*d + c*d^2) = LIGHT_CUTOFF for d
+    glm::vec3 abc = light.function;
+    float intensity = std::max({light.color.r, light.color.g, light.color.b});
+    float k = abc.x - intensity / LIGHT_CUTOFF;
+    if (k >= 0.f) return 0.f;
+
+    if (abc.z > 0.f) {
+        return (-abc.y + std::sqrt(abc.y * abc.y - 4.f * abc.z * k)) / (2.f * abc.z);
+    }
+    if (abc.y > 0.f) {
+        return -k / abc.y;
+    }
+    return std::numeric_limits<float>::infinity();
+}
+
+void compactLightLists(const std::vector<SceneLightData> &lights, const std::vector<LightListEntry> &entries,
+                       int numCells, std::vector<LightList> &cells, std::vector<int32_t> &indices) {
+    cells.assign(numCells, LightList{0, 0, 0, 0});
+    for (const LightListEntry &e : entries) {
+        if (lights[e.light].type == LightType::LIGHT_POINT) cells[e.cell].numPoint++;
+        else cells[e.cell].numSpot++;
+    }
+
+    int32_t offset = 0;
+    for (LightList &c : cells) {
+        c.offset = offset;
+        offset += c.numPoint + c.numSpot;
+    }
+
+    // pad doubles as the fill cursor, so each list keeps the entries' order
+    indices.resize(offset);
+    for (const LightListEntry &e : entries) {
+        LightList &c = cells[e.cell];
+        indices[c.offset + c.pad++] = e.light;
+    }
+    for (LightList &c : cells) c.pad = 0;
+}
+
+void TileFrustums::build(const glm::mat4 &proj, const std::vector<float> &edgesX, const std::vector<float> &edgesY) {
+    m_proj = proj;
+    m_edgesX = edgesX;
+    m_edgesY = edgesY;
+
+    // ndc.x = (P00*x + P20*z) / -z, so ndc.x >= x0 is the half space
+    // P00*x + (P20 + x0)*z >= 0 (glm is column-major)
+    float p00 = proj[0][0], p20 = proj[2][0];
+    float p11 = proj[1][1], p21 = proj[2][1];
+    near = proj[3][2] / (proj[2][2] - 1.f);
+    far = proj[3][2] / (proj[2][2] + 1.f);
+
+    m_planesX.resize(edgesX.size());
+    m_planesY.resize(edgesY.size());
+    for (size_t i = 0; i < edgesX.size(); i++) {
+        m_planesX[i] = glm::normalize(glm::vec3(p00, 0.f, p20 + edgesX[i]));
+    }
+    for (size_t j = 0; j < edgesY.size(); j++) {
+        m_planesY[j] = glm::normalize(glm::vec3(0.f, p11, p21 + edgesY[j]));
+    }
+}
+
+// Index of the tile containing ndc coordinate v, clamped to the grid
+static int tileIndex(const std::vector<float> &edges, float v) {
+    int i = int(std::upper_bound(edges.begin(), edges.end(), v) - edges.begin()) - 1;
+    return std::clamp(i, 0, int(edges.size()) - 2);
+}
+
+bool TileFrustums::bounds(const glm::vec3 &center, float radius, glm::ivec4 &rect) const {
+    // View distance is -z
+    if (-center.z + radius <= 0.f) return false;
+
+    int tilesX = int(m_edgesX.size()) - 1, tilesY = int(m_edgesY.size()) - 1;
+    rect = glm::ivec4(0, 0, tilesX - 1, tilesY - 1);
+
+    // Boxes reaching past the near plane would project badly, so they cover the
+    // whole screen and only the per-tile plane tests cull them
+    if (-center.z - radius <= near || !std::isfinite(radius)) return true;
+
+    glm::vec2 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+    for (int k = 0; k < 8; k++) {
+        glm::vec3 p = center + radius * glm::vec3(k & 1 ? 1.f : -1.f, k & 2 ? 1.f : -1.f, k & 4 ? 1.f : -1.f);
+        glm::vec4 clip = m_proj * glm::vec4(p, 1.f);
+        glm::vec2 ndc = glm::vec2(clip) / clip.w;
+        lo = glm::min(lo, ndc);
+        hi = glm::max(hi, ndc);
+    }
+    if (hi.x < -1.f || lo.x > 1.f || hi.y < -1.f || lo.y > 1.f) return false;
+
+    rect = glm::ivec4(tileIndex(m_edgesX, lo.x), tileIndex(m_edgesY, lo.y),
+                      tileIndex(m_edgesX, hi.x), tileIndex(m_edgesY, hi.y));
+    return true;
+}
+
+void TileLightGrid::resize(int width, int height) {
+    m_width = width;
+    m_height = height;
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    // The last row and column may be partial
+    m_edgesX.resize(tilesX + 1);
+    m_edgesY.resize(tilesY + 1);
+    for (int i = 0; i <= tilesX; i++) m_edgesX[i] = std::min(-1.f + 2.f * float(i * TILE_SIZE) / width, 1.f);
+    for (int j = 0; j <= tilesY; j++) m_edgesY[j] = std::min(-1.f + 2.f * float(j * TILE_SIZE) / height, 1.f);
+}
+
+void TileLightGrid::build(const std::vector<SceneLightData> &lights,
+                          const glm::mat4 &view, const glm::mat4 &proj,
+                          const std::vector<glm::vec2> &depthBounds) {
+    m_frustums.build(proj, m_edgesX, m_edgesY);
+    m_entries.clear();
+
+    for (int li = 0; li < int(lights.size()); li++) {
+        const SceneLightData &L = lights[li];
+        if (L.type == LightType::LIGHT_DIRECTIONAL) continue;
+
+        float r = lightRange(L);
+        if (r <= 0.f) continue;
+        glm::vec3 c = glm::vec3(view * glm::vec4(glm::vec3(L.pos), 1.f));
+
+        glm::ivec4 rect;
+        if (!m_frustums.bounds(c, r, rect)) continue;
+        float zNear = -c.z - r, zFar = -c.z + r;
+
+        for (int ty = rect.y; ty <= rect.w; ty++) {
+            if (!m_frustums.overlapsRow(ty, c, r)) continue;
+
+            for (int tx = rect.x; tx <= rect.z; tx++) {
+                int tile = ty * tilesX + tx;
+                glm::vec2 depth = depthBounds[tile];
+                if (depth.x > depth.y || zFar < depth.x || zNear > depth.y) continue;
+                if (!m_frustums.overlapsColumn(tx, c, r)) continue;
+
+                m_entries.push_back({tile, li});
+            }
+        }
+    }
+
+    compactLightLists(lights, m_entries, tilesX * tilesY, m_tiles, m_indices);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "scenedata.h"
+
+// Distance at which a light's brightest channel, attenuated, drops below
+// LIGHT_CUTOFF, or +inf if it never gets there (e.g. constant-only falloff)
+constexpr float LIGHT_CUTOFF = 1.f / 256.f;
+float lightRange(const SceneLightData &light);
+
+// A cell's range of a light index list, point lights before spot lights
+struct LightList {
+    int32_t offset;
+    int32_t numPoint;
+    int32_t numSpot;
+    int32_t pad;
+};
+
+struct LightListEntry {
+    int32_t cell;
+    int32_t light;
+};
+
+// Counting-sorts (cell, light) entries into per-cell LightLists over one index
+// list. Entries must be in light order with points before spots.
+void compactLightLists(const std::vector<SceneLightData> &lights, const std::vector<LightListEntry> &entries,
+                       int numCells, std::vector<LightList> &cells, std::vector<int32_t> &indices);
+
+// Side planes of a grid of screen tiles, for testing view-space light spheres
+// against tile frustums. Shared by TileLightGrid and ClusterLightGrid.
+class TileFrustums {
+public:
+    float near = 0.f;
+    float far = 0.f;
+
+    // @param edgesX, edgesY tile boundaries in NDC, ascending from -1 to 1
+    void build(const glm::mat4 &proj, const std::vector<float> &edgesX, const std::vector<float> &edgesY);
+
+    // Conservative tile rectangle (x0, y0, x1, y1, inclusive) covered by the
+    // sphere; false if it is entirely off screen or behind the eye
+    bool bounds(const glm::vec3 &center, float radius, glm::ivec4 &rect) const;
+
+    bool overlapsColumn(int tx, const glm::vec3 &center, float radius) const {
+        return glm::dot(m_planesX[tx], center) >= -radius && glm::dot(m_planesX[tx + 1], center) <= radius;
+    }
+    bool overlapsRow(int ty, const glm::vec3 &center, float radius) const {
+        return glm::dot(m_planesY[ty], center) >= -radius && glm::dot(m_planesY[ty + 1], center) <= radius;
+    }
+
+private:
+    glm::mat4 m_proj;
+    std::vector<float> m_edgesX, m_edgesY;
+    // Planes through the eye at each edge, normalised and facing increasing NDC
+    std::vector<glm::vec3> m_planesX, m_planesY;
+};
+
+// Screen split into TILE_SIZE x TILE_SIZE pixel tiles, each holding the point
+// and spot lights whose influence sphere intersects the tile's view frustum
+// (side planes plus the tile's depth bounds). Directional lights touch every
+// pixel and are not stored. Pure CPU so it can be benchmarked without a context.
+class TileLightGrid {
+public:
+    static constexpr int TILE_SIZE = 16;
+
+    using Tile = LightList;
+
+    int tilesX = 0;
+    int tilesY = 0;
+
+    void resize(int width, int height);
+
+    // @param lights sorted directional, point, spot (see LightBuffer)
+    // @param depthBounds per tile (min, max) view distance, row 0 at the bottom;
+    //        tiles with min > max contain no geometry
+    void build(const std::vector<SceneLightData> &lights,
+               const glm::mat4 &view, const glm::mat4 &proj,
+               const std::vector<glm::vec2> &depthBounds);
+
+    const std::vector<Tile> &tiles() const { return m_tiles; }
+    // Indices into the light list, points before spots within each tile
+    const std::vector<int32_t> &indices() const { return m_indices; }
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+
+    std::vector<Tile> m_tiles;
+    std::vector<int32_t> m_indices;
+
+    // Kept to avoid reallocating every frame
+    std::vector<LightListEntry> m_entries;
+    std::vector<float> m_edgesX, m_edgesY;
+    TileFrustums m_frustums;
+};